@@ -0,0 +1,484 @@
+#pragma once
+/**
+ * @~english
+ * @file aggregate.hpp
+ * @brief Mergeable aggregates of units with a compact binary state that carries the unit.
+ *
+ * Each aggregate can serialize its partial state and merge a serialized partial directly. The state starts with a
+ * header holding the aggregate kind, the value type and the unit's exponents and exact ratio. MergeSerialized()
+ * checks that header against the receiving aggregate before touching the payload, so a partial in the wrong units,
+ * ratio or value type is rejected at load time instead of being merged. All integers and floats are stored little
+ * endian, independent of the host.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "dimensions.hpp"
+#include "unit.hpp"
+
+namespace units {
+namespace detail {
+
+/**
+ * @~english
+ * Appends fixed-width little endian fields to a string.
+ */
+class AggregateWriter {
+ public:
+  explicit AggregateWriter(std::string* out) : out_(out) {}
+
+  void PutByte(uint8_t v) { out_->push_back(static_cast<char>(v)); }
+
+  void PutU64(uint64_t v) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) bytes[i] = static_cast<char>(v >> (8 * i));
+    out_->append(bytes, 8);
+  }
+
+  template <typename T>
+  void PutValue(T v) {
+    static_assert(sizeof(T) <= 8, "Values wider than 64 bits are not supported.");
+    uint64_t bits = 0;
+    if (std::is_floating_point<T>::value && sizeof(T) == 4) {
+      uint32_t narrow;
+      std::memcpy(&narrow, &v, 4);
+      bits = narrow;
+    } else if (std::is_floating_point<T>::value) {
+      std::memcpy(&bits, &v, sizeof(T));
+    } else {
+      bits = static_cast<uint64_t>(static_cast<int64_t>(v));
+    }
+    PutU64(bits);
+  }
+
+ private:
+  std::string* out_;
+};
+
+/**
+ * @~english
+ * Reads fields written by AggregateWriter, failing instead of reading past the end.
+ */
+class AggregateReader {
+ public:
+  AggregateReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  bool GetByte(uint8_t* v) {
+    if (pos_ + 1 > size_) return false;
+    *v = static_cast<uint8_t>(data_[pos_++]);
+    return true;
+  }
+
+  bool GetU64(uint64_t* v) {
+    if (pos_ + 8 > size_) return false;
+    *v = 0;
+    for (int i = 0; i < 8; ++i) *v |= uint64_t(static_cast<uint8_t>(data_[pos_ + i])) << (8 * i);
+    pos_ += 8;
+    return true;
+  }
+
+  template <typename T>
+  bool GetValue(T* v) {
+    uint64_t bits;
+    if (!GetU64(&bits)) return false;
+    if (std::is_floating_point<T>::value && sizeof(T) == 4) {
+      const uint32_t narrow = static_cast<uint32_t>(bits);
+      std::memcpy(v, &narrow, 4);
+    } else if (std::is_floating_point<T>::value) {
+      std::memcpy(v, &bits, sizeof(T));
+    } else {
+      *v = static_cast<T>(static_cast<int64_t>(bits));
+    }
+    return true;
+  }
+
+  bool AtEnd() const noexcept { return pos_ == size_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t pos_ = 0;
+};
+
+/**
+ * @~english
+ * Kinds of serialized aggregates.
+ */
+enum class AggregateKind : uint8_t { kSum = 1, kMinMax = 2, kMoments = 3, kHistogram = 4 };
+
+constexpr uint8_t kAggregateVersion = 1;
+
+/**
+ * @~english
+ * Encodes a value type as its size, with bit 6 set for floating point and bit 7 for signed types.
+ */
+template <typename T>
+constexpr uint8_t ValueTypeTag() noexcept {
+  return uint8_t(sizeof(T) | (std::is_floating_point<T>::value ? 0x40 : 0) | (std::is_signed<T>::value ? 0x80 : 0));
+}
+
+template <typename U>
+void WriteAggregateHeader(AggregateKind kind, AggregateWriter* w) {
+  const Dimensions d = Dimensions::Of<U>();
+  w->PutByte('U');
+  w->PutByte(kAggregateVersion);
+  w->PutByte(static_cast<uint8_t>(kind));
+  w->PutByte(ValueTypeTag<typename U::value_type>());
+  for (int32_t e : d.exponents) w->PutU64(static_cast<uint64_t>(static_cast<int64_t>(e)));
+  w->PutU64(U::GetNum());
+  w->PutU64(U::GetDen());
+}
+
+/**
+ * @~english
+ * Reads a header and checks it against the aggregate kind and unit U.
+ */
+template <typename U>
+bool ReadAggregateHeader(AggregateKind kind, AggregateReader* r, std::string* error) {
+  const auto fail = [error](const char* message) {
+    if (error != nullptr) *error = message;
+    return false;
+  };
+  uint8_t magic, version, k, tag;
+  if (!r->GetByte(&magic) || !r->GetByte(&version) || !r->GetByte(&k) || !r->GetByte(&tag)) {
+    return fail("truncated aggregate");
+  }
+  if (magic != 'U' || version != kAggregateVersion) return fail("not a serialized aggregate");
+  if (k != static_cast<uint8_t>(kind)) return fail("aggregate kind mismatch");
+  if (tag != ValueTypeTag<typename U::value_type>()) return fail("value type mismatch");
+  const Dimensions d = Dimensions::Of<U>();
+  for (int32_t e : d.exponents) {
+    uint64_t v;
+    if (!r->GetU64(&v)) return fail("truncated aggregate");
+    if (static_cast<int64_t>(v) != e) return fail("dimension mismatch");
+  }
+  uint64_t num, den;
+  if (!r->GetU64(&num) || !r->GetU64(&den)) return fail("truncated aggregate");
+  if (num != U::GetNum() || den != U::GetDen()) return fail("scale mismatch");
+  return true;
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * @brief Count and sum of units.
+ */
+template <typename U>
+class SumAggregate {
+ public:
+  using value_type = typename U::value_type;
+
+  void Add(const U& u) noexcept {
+    sum_ += u.GetValue();
+    ++count_;
+  }
+
+  void Add(const U* u, size_t n) noexcept {
+    value_type sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += u[i].GetValue();
+    sum_ += sum;
+    count_ += n;
+  }
+
+  void Merge(const SumAggregate& other) noexcept {
+    sum_ += other.sum_;
+    count_ += other.count_;
+  }
+
+  uint64_t GetCount() const noexcept { return count_; }
+  U GetSum() const noexcept { return U(sum_); }
+
+  /**
+   * @~english
+   * Appends the serialized state to out.
+   */
+  void Serialize(std::string* out) const {
+    detail::AggregateWriter w(out);
+    detail::WriteAggregateHeader<U>(detail::AggregateKind::kSum, &w);
+    w.PutU64(count_);
+    w.PutValue(sum_);
+  }
+
+  /**
+   * @~english
+   * Merges a serialized partial.
+   * @param data The serialized state.
+   * @param size The size of the state in bytes.
+   * @param error Receives the reason on failure. May be null.
+   * @return False, leaving this aggregate unchanged, if the state is malformed or of another kind, value type, unit
+   * or ratio.
+   */
+  bool MergeSerialized(const char* data, size_t size, std::string* error = nullptr) {
+    detail::AggregateReader r(data, size);
+    if (!detail::ReadAggregateHeader<U>(detail::AggregateKind::kSum, &r, error)) return false;
+    SumAggregate other;
+    if (!r.GetU64(&other.count_) || !r.GetValue(&other.sum_) || !r.AtEnd()) {
+      if (error != nullptr) *error = "malformed aggregate payload";
+      return false;
+    }
+    Merge(other);
+    return true;
+  }
+
+ private:
+  uint64_t count_ = 0;
+  value_type sum_ = 0;
+};
+
+/**
+ * @~english
+ * @brief Count, minimum and maximum of units.
+ */
+template <typename U>
+class MinMaxAggregate {
+ public:
+  using value_type = typename U::value_type;
+
+  void Add(const U& u) noexcept {
+    min_ = std::min(min_, u.GetValue());
+    max_ = std::max(max_, u.GetValue());
+    ++count_;
+  }
+
+  void Add(const U* u, size_t n) noexcept {
+    value_type lo = min_, hi = max_;
+    for (size_t i = 0; i < n; ++i) {
+      lo = u[i].GetValue() < lo ? u[i].GetValue() : lo;
+      hi = u[i].GetValue() > hi ? u[i].GetValue() : hi;
+    }
+    min_ = lo;
+    max_ = hi;
+    count_ += n;
+  }
+
+  void Merge(const MinMaxAggregate& other) noexcept {
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    count_ += other.count_;
+  }
+
+  uint64_t GetCount() const noexcept { return count_; }
+
+  /**
+   * @~english
+   * Gets the minimum. The largest finite value while empty.
+   */
+  U GetMin() const noexcept { return U(min_); }
+
+  /**
+   * @~english
+   * Gets the maximum. The lowest finite value while empty.
+   */
+  U GetMax() const noexcept { return U(max_); }
+
+  void Serialize(std::string* out) const {
+    detail::AggregateWriter w(out);
+    detail::WriteAggregateHeader<U>(detail::AggregateKind::kMinMax, &w);
+    w.PutU64(count_);
+    w.PutValue(min_);
+    w.PutValue(max_);
+  }
+
+  /**
+   * @~english
+   * Merges a serialized partial. See SumAggregate::MergeSerialized.
+   */
+  bool MergeSerialized(const char* data, size_t size, std::string* error = nullptr) {
+    detail::AggregateReader r(data, size);
+    if (!detail::ReadAggregateHeader<U>(detail::AggregateKind::kMinMax, &r, error)) return false;
+    MinMaxAggregate other;
+    if (!r.GetU64(&other.count_) || !r.GetValue(&other.min_) || !r.GetValue(&other.max_) || !r.AtEnd()) {
+      if (error != nullptr) *error = "malformed aggregate payload";
+      return false;
+    }
+    Merge(other);
+    return true;
+  }
+
+ private:
+  uint64_t count_ = 0;
+  value_type min_ = std::numeric_limits<value_type>::max();
+  value_type max_ = std::numeric_limits<value_type>::lowest();
+};
+
+/**
+ * @~english
+ * @brief Count, mean and variance of units, accumulated with Welford's method and merged with Chan's formula.
+ */
+template <typename U>
+class MomentsAggregate {
+ public:
+  using value_type = typename U::value_type;
+  static_assert(std::is_floating_point<value_type>::value, "Moments require a floating point value type.");
+
+  void Add(const U& u) noexcept {
+    ++count_;
+    const value_type delta = u.GetValue() - mean_;
+    mean_ += delta / value_type(count_);
+    m2_ += delta * (u.GetValue() - mean_);
+  }
+
+  void Merge(const MomentsAggregate& other) noexcept {
+    if (other.count_ == 0) return;
+    const uint64_t count = count_ + other.count_;
+    const value_type delta = other.mean_ - mean_;
+    const value_type weight = value_type(other.count_) / value_type(count);
+    mean_ += delta * weight;
+    m2_ += other.m2_ + delta * delta * value_type(count_) * weight;
+    count_ = count;
+  }
+
+  uint64_t GetCount() const noexcept { return count_; }
+  U GetMean() const noexcept { return U(mean_); }
+
+  /**
+   * @~english
+   * Gets the sample variance, in the square of U.
+   */
+  decltype(std::declval<U>() * std::declval<U>()) GetVariance() const noexcept {
+    return {count_ > 1 ? m2_ / value_type(count_ - 1) : value_type(0)};
+  }
+
+  /**
+   * @~english
+   * Gets the sample standard deviation.
+   */
+  U GetStddev() const noexcept { return U(std::sqrt(GetVariance().GetValue())); }
+
+  void Serialize(std::string* out) const {
+    detail::AggregateWriter w(out);
+    detail::WriteAggregateHeader<U>(detail::AggregateKind::kMoments, &w);
+    w.PutU64(count_);
+    w.PutValue(mean_);
+    w.PutValue(m2_);
+  }
+
+  /**
+   * @~english
+   * Merges a serialized partial. See SumAggregate::MergeSerialized.
+   */
+  bool MergeSerialized(const char* data, size_t size, std::string* error = nullptr) {
+    detail::AggregateReader r(data, size);
+    if (!detail::ReadAggregateHeader<U>(detail::AggregateKind::kMoments, &r, error)) return false;
+    MomentsAggregate other;
+    if (!r.GetU64(&other.count_) || !r.GetValue(&other.mean_) || !r.GetValue(&other.m2_) || !r.AtEnd()) {
+      if (error != nullptr) *error = "malformed aggregate payload";
+      return false;
+    }
+    Merge(other);
+    return true;
+  }
+
+ private:
+  uint64_t count_ = 0;
+  value_type mean_ = 0;
+  value_type m2_ = 0;
+};
+
+/**
+ * @~english
+ * @brief Histogram of units over equal-width bins, with underflow and overflow counts.
+ */
+template <typename U>
+class HistogramAggregate {
+ public:
+  using value_type = typename U::value_type;
+
+  /**
+   * @~english
+   * Constructor
+   * @param lo The lower edge of the first bin, in any ratio of U.
+   * @param hi The upper edge of the last bin, in any ratio of U.
+   * @param bins The number of bins. Throws std::invalid_argument if zero.
+   */
+  template <typename L, typename H>
+  HistogramAggregate(const L& lo, const H& hi, size_t bins)
+      : lo_(static_cast<U>(lo).GetValue()), hi_(static_cast<U>(hi).GetValue()), counts_(bins + 2, 0) {
+    if (bins == 0) throw std::invalid_argument("histogram without bins");
+  }
+
+  void Add(const U& u) noexcept { ++counts_[Bin(u.GetValue())]; }
+
+  void Add(const U* u, size_t n) noexcept {
+    for (size_t i = 0; i < n; ++i) ++counts_[Bin(u[i].GetValue())];
+  }
+
+  /**
+   * @~english
+   * Merges another histogram with the same edges.
+   * @return False, leaving this histogram unchanged, if the edges differ.
+   */
+  bool Merge(const HistogramAggregate& other) noexcept {
+    if (other.lo_ != lo_ || other.hi_ != hi_ || other.counts_.size() != counts_.size()) return false;
+    for (size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+    return true;
+  }
+
+  size_t Bins() const noexcept { return counts_.size() - 2; }
+  uint64_t GetCount(size_t bin) const noexcept { return counts_[bin + 1]; }
+  uint64_t GetUnderflow() const noexcept { return counts_.front(); }
+  uint64_t GetOverflow() const noexcept { return counts_.back(); }
+
+  void Serialize(std::string* out) const {
+    detail::AggregateWriter w(out);
+    detail::WriteAggregateHeader<U>(detail::AggregateKind::kHistogram, &w);
+    w.PutValue(lo_);
+    w.PutValue(hi_);
+    w.PutU64(counts_.size());
+    for (uint64_t c : counts_) w.PutU64(c);
+  }
+
+  /**
+   * @~english
+   * Merges a serialized partial. Also rejects partials with other bin edges. See SumAggregate::MergeSerialized.
+   */
+  bool MergeSerialized(const char* data, size_t size, std::string* error = nullptr) {
+    detail::AggregateReader r(data, size);
+    if (!detail::ReadAggregateHeader<U>(detail::AggregateKind::kHistogram, &r, error)) return false;
+    value_type lo, hi;
+    uint64_t slots;
+    if (!r.GetValue(&lo) || !r.GetValue(&hi) || !r.GetU64(&slots)) {
+      if (error != nullptr) *error = "malformed aggregate payload";
+      return false;
+    }
+    if (lo != lo_ || hi != hi_ || slots != counts_.size()) {
+      if (error != nullptr) *error = "histogram bins mismatch";
+      return false;
+    }
+    std::vector<uint64_t> counts(counts_.size());
+    bool complete = true;
+    for (uint64_t& c : counts) complete = complete && r.GetU64(&c);
+    if (!complete || !r.AtEnd()) {
+      if (error != nullptr) *error = "malformed aggregate payload";
+      return false;
+    }
+    for (size_t i = 0; i < counts_.size(); ++i) counts_[i] += counts[i];
+    return true;
+  }
+
+ private:
+  size_t Bin(value_type v) const noexcept {
+    if (!(v >= lo_)) return 0;
+    if (!(v < hi_)) return counts_.size() - 1;
+    // Integers are binned in long double, where neither the offset nor its product with the bin count overflows.
+    using wide = typename std::conditional<std::is_integral<value_type>::value, long double, value_type>::type;
+    const size_t bin = static_cast<size_t>((wide(v) - wide(lo_)) * wide(counts_.size() - 2) / (wide(hi_) - wide(lo_)));
+    return 1 + std::min(bin, counts_.size() - 3);
+  }
+
+  value_type lo_;
+  value_type hi_;
+  std::vector<uint64_t> counts_;
+};
+
+}  // namespace units
@@ -0,0 +1,84 @@
+/**
+ * @~english
+ * @file range_check.cpp
+ * @brief Alarm evaluation over int32 milliampere samples: Unit's cross-ratio comparisons against the batch kernels.
+ *
+ * Build from the repository root with: g++ -std=c++14 -O3 -march=native -pthread benchmark/range_check.cpp -o
+ * range_check_benchmark, and pass the number of samples as the first argument (default 10^8).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "../range_check.hpp"
+#include "../unit.hpp"
+
+using namespace units;
+
+namespace {
+
+using Milliampere = Unit<int32_t, 0, 0, 0, 0, 0, 1, 0, 1, 1000>;
+using Ampere = Unit<int32_t, 0, 0, 0, 0, 0, 1, 0>;
+
+/**
+ * @~english
+ * Times f, keeping the best of a few runs.
+ * @return Milliseconds and the result of the last run.
+ */
+template <typename F>
+std::pair<double, size_t> Time(F f) {
+  double best = 1e300;
+  size_t result = 0;
+  for (int run = 0; run < 3; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    result = f();
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return {best, result};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000000;
+  std::vector<Milliampere> samples(n);
+  uint64_t state = 88172645463325252ULL;
+  for (size_t i = 0; i < n; ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    // Within +-20 A except -20001 mA, one sample in 40002 on average.
+    samples[i] = Milliampere(int32_t(state % 40002) - 20001);
+  }
+  const Ampere low(-20), high(20);
+  const Limits<Milliampere> limits(low, high);
+  std::vector<uint64_t> bitmap((n + 63) / 64);
+  std::vector<size_t> indices(n);
+  std::vector<Milliampere> clamped(n);
+
+  const auto naive = Time([&] {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) count += samples[i] < low || samples[i] > high;
+    return count;
+  });
+  const auto single = Time([&] { return CheckRange(samples.data(), n, limits, bitmap.data(), 1); });
+  const auto bits = Time([&] { return CheckRange(samples.data(), n, limits, bitmap.data()); });
+  const auto list = Time([&] { return FindViolations(samples.data(), n, limits, indices.data()); });
+  const auto clamp = Time([&] { return Clamp(samples.data(), clamped.data(), n, limits); });
+
+  std::printf("%zu samples, %zu violations\n", n, naive.second);
+  std::printf("%-36s %10.2f ms\n", "Unit operator< / operator>", naive.first);
+  std::printf("%-36s %10.2f ms\n", "CheckRange bitmap, 1 thread", single.first);
+  std::printf("%-36s %10.2f ms\n", "CheckRange bitmap, all threads", bits.first);
+  std::printf("%-36s %10.2f ms\n", "FindViolations index list", list.first);
+  std::printf("%-36s %10.2f ms\n", "Clamp", clamp.first);
+  const bool agree = single.second == naive.second && bits.second == naive.second && list.second == naive.second &&
+                     clamp.second == naive.second;
+  return agree ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/**
+ * @~english
+ * @file scale_policy.cpp
+ * @brief Rescales and run time of chained Unit::operator+ against ScaledSum() over int64 columns of mixed ratios.
+ *
+ * The policy rescales fewer terms than the chain only when the chain drifts to a ratio none of the terms has, as in the
+ * m/3 and m/7 mixes reaching 1/21 m, or when CoarserScale stays in the ratio of most terms by truncating the finer
+ * ones, as in m + cm + m + m. With FinerScale, mixes of SI prefixes rescale as often as the chain and time the same
+ * within noise. Rows marked "results differ" truncate integral terms at different points: the chain truncates once
+ * when its exact sum is read in the policy's ratio, while the policy truncates every term that is not a multiple of
+ * its ratio.
+ *
+ * Build from the repository root with: g++ -std=c++14 -O2 benchmark/scale_policy.cpp -o scale_policy_benchmark
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ratio>
+#include <utility>
+#include <vector>
+
+#include "../scale_policy.hpp"
+#include "../unit.hpp"
+
+using namespace units;
+
+namespace {
+
+/**
+ * @~english
+ * Rescales done by the left fold a + b + c + ..., where each step rescales every operand not already in its result.
+ */
+template <typename U, typename... Us>
+struct ChainRescales {
+  static constexpr size_t value = 0;
+};
+
+template <typename U, typename V, typename... Us>
+struct ChainRescales<U, V, Us...> {
+  using step = decltype(std::declval<U>() + std::declval<V>());
+  static constexpr size_t value = !std::ratio_equal<typename U::scale, typename step::scale>::value +
+                                  !std::ratio_equal<typename V::scale, typename step::scale>::value +
+                                  ChainRescales<step, Us...>::value;
+};
+
+/**
+ * @~english
+ * Times f over n rows, keeping the best of a few runs.
+ * @return Nanoseconds per row and the checksum of the last run.
+ */
+template <typename F>
+std::pair<double, int64_t> Time(size_t n, F f) {
+  double best = 1e300;
+  int64_t checksum = 0;
+  for (int run = 0; run < 5; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    checksum = 0;
+    for (size_t i = 0; i < n; ++i) checksum += f(i);
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / n);
+  }
+  return {best, checksum};
+}
+
+/**
+ * @~english
+ * Sums one row of four columns both ways, with both results read in the policy's ratio, and prints the comparison.
+ */
+template <typename Policy, typename A, typename B, typename C, typename D>
+void Compare(const char* name, size_t n) {
+  std::vector<A> a(n);
+  std::vector<B> b(n);
+  std::vector<C> c(n);
+  std::vector<D> d(n);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = A(int64_t(i % 1000));
+    b[i] = B(int64_t(i % 997));
+    c[i] = C(int64_t(i % 991));
+    d[i] = D(int64_t(i % 983));
+  }
+  using R = typename ScaleChoice<Policy, A, B, C, D>::type;
+  using Chain = decltype(A() + B() + C() + D());
+  // Reading the chained sum in R costs one more rescale unless the chain already ended there.
+  const size_t chained = ChainRescales<A, B, C, D>::value + !std::ratio_equal<typename Chain::scale, typename R::scale>::value;
+  const auto fold = Time(n, [&](size_t i) { return R(a[i] + b[i] + c[i] + d[i]).GetValue(); });
+  const auto policy = Time(n, [&](size_t i) { return ScaledSum<Policy>(a[i], b[i], c[i], d[i]).GetValue(); });
+  std::printf("%-28s %10zu %10zu %12.3f %12.3f %s\n", name, chained, ScaleChoice<Policy, A, B, C, D>::rescales,
+              fold.first, policy.first, fold.second == policy.second ? "" : "(results differ)");
+}
+
+}  // namespace
+
+int main() {
+  const size_t n = 1 << 22;
+  using Third = i::Meter::units<1, 3>;
+  using Seventh = i::Meter::units<1, 7>;
+  std::printf("%-28s %10s %10s %12s %12s\n", "terms", "fold ops", "policy ops", "fold ns/row", "policy ns/row");
+  Compare<FinerScale, i::Millimeter, i::Centimeter, i::Millimeter, i::Millimeter>("mm + cm + mm + mm", n);
+  Compare<FinerScale, i::Millimeter, i::Meter, i::Millimeter, i::Centimeter>("mm + m + mm + cm", n);
+  Compare<FinerScale, Third, Seventh, Third, Third>("m/3 + m/7 + m/3 + m/3", n);
+  Compare<CoarserScale, Seventh, Third, Seventh, Seventh>("m/7 + m/3 + m/7 + m/7", n);
+  Compare<CoarserScale, i::Meter, i::Centimeter, i::Meter, i::Meter>("m + cm + m + m", n);
+  return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @~english
+ * @file seqlock.cpp
+ * @brief Reader scaling of SeqLock against a mutex while a writer publishes at 10 kHz.
+ *
+ * Build from the repository root with: g++ -std=c++14 -O2 -pthread benchmark/seqlock.cpp -o seqlock_benchmark
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../seqlock.hpp"
+#include "../unit.hpp"
+
+using namespace units;
+
+namespace {
+
+using MeterPerSecond = decltype(d::Meter(1.0) / d::Second(1.0));
+
+struct State {
+  d::Meter x, y, z;
+  MeterPerSecond vx, vy, vz;
+  d::Ampere current;
+  uint64_t tick;
+};
+
+/**
+ * @~english
+ * Runs a 10 kHz writer and the given number of readers for a fixed time.
+ * @return Total reads per second and the number of torn reads observed.
+ */
+template <typename Publish, typename Read>
+std::pair<double, size_t> Run(unsigned readers, Publish publish, Read read) {
+  const auto duration = std::chrono::milliseconds(500);
+  std::atomic<bool> done(false);
+  std::atomic<size_t> reads(0), torn(0);
+  std::thread writer([&] {
+    auto next = std::chrono::steady_clock::now();
+    for (uint64_t tick = 1; !done; ++tick) {
+      const double v = double(tick);
+      publish(State{d::Meter(v), d::Meter(v), d::Meter(v), MeterPerSecond(v), MeterPerSecond(v), MeterPerSecond(v),
+                    d::Ampere(v), tick});
+      next += std::chrono::microseconds(100);
+      std::this_thread::sleep_until(next);
+    }
+  });
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < readers; ++t) {
+    threads.emplace_back([&] {
+      size_t count = 0, bad = 0;
+      while (!done) {
+        const State s = read();
+        bad += s.x.GetValue() != s.current.GetValue() || s.vz.GetValue() != double(s.tick);
+        ++count;
+      }
+      reads += count;
+      torn += bad;
+    });
+  }
+  std::this_thread::sleep_for(duration);
+  done = true;
+  writer.join();
+  for (auto& t : threads) t.join();
+  return {reads / std::chrono::duration<double>(duration).count(), torn.load()};
+}
+
+}  // namespace
+
+int main() {
+  const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  std::printf("%8s %16s %16s %8s\n", "readers", "seqlock reads/s", "mutex reads/s", "torn");
+  for (unsigned readers = 1; readers <= cores; readers = readers < cores ? std::min(cores, readers * 2) : cores + 1) {
+    SeqLock<State> seqlock;
+    const auto lock_free = Run(readers, [&](const State& s) { seqlock.Store(s); }, [&] { return seqlock.Load(); });
+
+    std::mutex mutex;
+    State shared{};
+    const auto locked = Run(readers,
+                            [&](const State& s) {
+                              std::lock_guard<std::mutex> lock(mutex);
+                              shared = s;
+                            },
+                            [&] {
+                              std::lock_guard<std::mutex> lock(mutex);
+                              return shared;
+                            });
+    std::printf("%8u %16.0f %16.0f %8zu\n", readers, lock_free.first, locked.first, lock_free.second + locked.second);
+  }
+  return 0;
+}
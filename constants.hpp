@@ -0,0 +1,67 @@
+#pragma once
+/**
+ * @~english
+ * @file constants.hpp
+ * @brief Constexpr physical constants as typed units.
+ *
+ * The exact decimal digits of each constant live in the compile-time ratio and the value only holds the remaining
+ * power of ten, so exact constants such as c and g_n are folded entirely into the ratio with a value of one.
+ * The ratios are kept small enough that products of a few constants still fit the 64-bit ratio arithmetic.
+ * Masses are expressed in grams, the base mass unit of this library.
+ */
+
+#include "unit.hpp"
+
+namespace units {
+namespace constants {
+
+/**
+ * @~english
+ * Speed of light in vacuum, exactly 299792458 m/s.
+ */
+constexpr Unit<double, -1, 1, 0, 0, 0, 0, 0, 299792458, 1> kSpeedOfLight(1.0);
+
+/**
+ * @~english
+ * Planck constant, exactly 6.62607015e-34 J s = 662607015e-39 g m^2 / s.
+ */
+constexpr Unit<double, -1, 2, 0, 0, 0, 0, 1, 662607015, 1> kPlanck(1e-39);
+
+/**
+ * @~english
+ * Boltzmann constant, exactly 1.380649e-23 J/K = 1380649e-26 g m^2 / (s^2 K).
+ */
+constexpr Unit<double, -2, 2, 0, -1, 0, 0, 1, 1380649, 1> kBoltzmann(1e-26);
+
+/**
+ * @~english
+ * Elementary charge, exactly 1.602176634e-19 C = 1602176634e-28 A s.
+ */
+constexpr Unit<double, 1, 0, 0, 0, 0, 1, 0, 1602176634, 1> kElementaryCharge(1e-28);
+
+/**
+ * @~english
+ * Hyperfine transition frequency of caesium 133, exactly 9192631770 Hz.
+ */
+constexpr Unit<double, -1, 0, 0, 0, 0, 0, 0, 9192631770, 1> kCaesiumFrequency(1.0);
+
+/**
+ * @~english
+ * Standard acceleration of gravity, exactly 9.80665 m/s^2.
+ */
+constexpr Unit<double, -2, 1, 0, 0, 0, 0, 0, 196133, 20000> kStandardGravity(1.0);
+
+/**
+ * @~english
+ * Newtonian constant of gravitation, 6.67430e-11 m^3 / (kg s^2) = 66743e-18 m^3 / (g s^2) (CODATA 2018).
+ */
+constexpr Unit<double, -2, 3, 0, 0, 0, 0, -1, 66743, 1> kGravitational(1e-18);
+
+/**
+ * @~english
+ * Electron mass, 9.1093837015e-31 kg (CODATA 2018). Kept in the value so m_e c^2 stays within 64-bit ratios.
+ */
+constexpr Unit<double, 0, 0, 0, 0, 0, 0, 1, 1, 1> kElectronMass(9.1093837015e-28);
+
+}  // namespace constants
+}  // namespace units
@@ -0,0 +1,260 @@
+#pragma once
+/**
+ * @~english
+ * @file decibel.hpp
+ * @brief Logarithmic levels (dB, dBm, neper) backed by a linear reference unit.
+ *
+ * A Decibel is a dimensionless gain. A Level<Ref, Kind> is an absolute level relative to one Ref, e.g. dBm is relative
+ * to one milliwatt. Gains add to levels in the log domain, and the difference of two levels is a gain. The bulk
+ * conversions use branch-free log2/exp2 approximations (about 1e-12 relative error) that vectorize.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Level kind for power quantities, 10 log10(P / P0).
+ */
+struct PowerRatio {
+  static constexpr double kFactor = 10.0;
+};
+
+/**
+ * @~english
+ * @brief Level kind for root-power (field) quantities such as voltage, 20 log10(V / V0).
+ */
+struct FieldRatio {
+  static constexpr double kFactor = 20.0;
+};
+
+/**
+ * @~english
+ * @brief Dimensionless gain in decibels.
+ */
+class Decibel {
+ public:
+  Decibel() = default;
+
+  /**
+   * @~english
+   * Constructor
+   * @param db The gain in decibels.
+   */
+  constexpr explicit Decibel(double db) : db_(db) {}
+
+  /**
+   * @~english
+   * Creates a gain from nepers. One neper is 20 / ln(10) dB.
+   * @param np The gain in nepers.
+   * @return The gain.
+   */
+  static constexpr Decibel FromNepers(double np) noexcept { return Decibel(np * kDecibelsPerNeper); }
+
+  /**
+   * @~english
+   * Creates a gain from a linear power ratio.
+   * @param ratio The power ratio.
+   * @return The gain.
+   */
+  static Decibel FromPowerRatio(double ratio) noexcept { return Decibel(10.0 * std::log10(ratio)); }
+
+  constexpr double GetValue() const noexcept { return db_; }
+  constexpr double GetNepers() const noexcept { return db_ / kDecibelsPerNeper; }
+  double GetPowerRatio() const noexcept { return std::pow(10.0, db_ / 10.0); }
+  double GetFieldRatio() const noexcept { return std::pow(10.0, db_ / 20.0); }
+
+  constexpr Decibel operator-() const noexcept { return Decibel(-db_); }
+  constexpr Decibel operator+(Decibel other) const noexcept { return Decibel(db_ + other.db_); }
+  constexpr Decibel operator-(Decibel other) const noexcept { return Decibel(db_ - other.db_); }
+  Decibel& operator+=(Decibel other) noexcept { db_ += other.db_; return *this; }
+  Decibel& operator-=(Decibel other) noexcept { db_ -= other.db_; return *this; }
+
+  constexpr bool operator==(Decibel other) const noexcept { return db_ == other.db_; }
+  constexpr bool operator!=(Decibel other) const noexcept { return db_ != other.db_; }
+  constexpr bool operator<(Decibel other) const noexcept { return db_ < other.db_; }
+  constexpr bool operator>(Decibel other) const noexcept { return db_ > other.db_; }
+
+ private:
+  static constexpr double kDecibelsPerNeper = 8.6858896380650365530225783783321;
+
+  double db_;
+};
+
+/**
+ * @~english
+ * @brief Absolute level relative to one Ref.
+ */
+template <typename Ref, typename Kind = PowerRatio>
+class Level {
+ public:
+  static_assert(std::is_floating_point<typename Ref::value_type>::value, "Levels require a floating point reference.");
+
+  /**
+   * @~english
+   * The linear reference unit. A level of 0 dB equals one of these.
+   */
+  using reference = Ref;
+
+  Level() = default;
+
+  /**
+   * @~english
+   * Constructor
+   * @param db The level in decibels relative to the reference.
+   */
+  constexpr explicit Level(double db) : db_(db) {}
+
+  /**
+   * @~english
+   * Creates a level from a linear quantity in any ratio of the reference units.
+   * @param linear The linear quantity.
+   * @return The level.
+   */
+  template <typename U>
+  static Level FromLinear(const U& linear) noexcept {
+    return Level(Kind::kFactor * std::log10(static_cast<double>(static_cast<Ref>(linear).GetValue())));
+  }
+
+  /**
+   * @~english
+   * Converts the level back to a linear quantity.
+   * @return The linear quantity in the reference units.
+   */
+  Ref ToLinear() const noexcept { return Ref(std::pow(10.0, db_ / Kind::kFactor)); }
+
+  constexpr double GetValue() const noexcept { return db_; }
+
+  constexpr Level operator+(Decibel gain) const noexcept { return Level(db_ + gain.GetValue()); }
+  constexpr Level operator-(Decibel gain) const noexcept { return Level(db_ - gain.GetValue()); }
+  constexpr Decibel operator-(Level other) const noexcept { return Decibel(db_ - other.db_); }
+  Level& operator+=(Decibel gain) noexcept { db_ += gain.GetValue(); return *this; }
+  Level& operator-=(Decibel gain) noexcept { db_ -= gain.GetValue(); return *this; }
+
+  constexpr bool operator==(Level other) const noexcept { return db_ == other.db_; }
+  constexpr bool operator!=(Level other) const noexcept { return db_ != other.db_; }
+  constexpr bool operator<(Level other) const noexcept { return db_ < other.db_; }
+  constexpr bool operator>(Level other) const noexcept { return db_ > other.db_; }
+
+ private:
+  double db_;
+};
+
+/**
+ * @~english
+ * Power in milliwatts and watts, and voltage in volts, as reference units.
+ */
+using Milliwatt = Unit<double, -3, 2, 0, 0, 0, 0, 1, 1, 1>;
+using Watt = Unit<double, -3, 2, 0, 0, 0, 0, 1, 1000, 1>;
+using Volt = Unit<double, -3, 2, 0, 0, 0, -1, 1, 1000, 1>;
+
+using DecibelMilliwatt = Level<Milliwatt, PowerRatio>;
+using DecibelWatt = Level<Watt, PowerRatio>;
+using DecibelVolt = Level<Volt, FieldRatio>;
+
+namespace detail {
+
+/**
+ * @~english
+ * Branch-free log2 for positive normal doubles. Splits off the exponent and evaluates the atanh series of the
+ * mantissa in [sqrt(1/2), sqrt(2)).
+ */
+inline double FastLog2(double x) noexcept {
+  uint64_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  double e = static_cast<double>(static_cast<int64_t>((bits >> 52) & 0x7ff) - 1023);
+  bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+  double m;
+  std::memcpy(&m, &bits, sizeof(m));
+  const bool high = m > 1.4142135623730951;
+  m = high ? m * 0.5 : m;
+  e = high ? e + 1.0 : e;
+  const double t = (m - 1.0) / (m + 1.0);
+  const double t2 = t * t;
+  const double series =
+      1.0 + t2 * (1.0 / 3 + t2 * (1.0 / 5 + t2 * (1.0 / 7 + t2 * (1.0 / 9 + t2 * (1.0 / 11 + t2 / 13)))));
+  return e + 2.0 * t * series * 1.4426950408889634;
+}
+
+/**
+ * @~english
+ * Branch-free exp2 for results in the normal double range. Rounds y to an integer exponent and evaluates the
+ * Taylor series of 2^f for the remaining f in [-1/2, 1/2].
+ */
+inline double FastExp2(double y) noexcept {
+  y = y < -1022.0 ? -1022.0 : (y > 1023.0 ? 1023.0 : y);
+  const double n = std::floor(y + 0.5);
+  const double f = (y - n) * 0.6931471805599453;
+  const double p =
+      1.0 + f * (1.0 + f * (1.0 / 2 + f * (1.0 / 6 + f * (1.0 / 24 + f * (1.0 / 120 + f * (1.0 / 720 +
+      f * (1.0 / 5040 + f * (1.0 / 40320 + f * (1.0 / 362880 + f * (1.0 / 3628800))))))))));
+  const uint64_t bits = static_cast<uint64_t>(static_cast<int64_t>(n) + 1023) << 52;
+  double scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return p * scale;
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * Converts an array of linear quantities into levels. Non-positive inputs map to -infinity.
+ * @param linear The linear quantities, in any ratio of the reference units.
+ * @param out The levels.
+ * @param n The number of elements.
+ */
+template <typename Ref, typename Kind, typename U>
+void ToLevels(const U* linear, Level<Ref, Kind>* out, size_t n) noexcept {
+  static_assert(std::is_same<typename U::template units<1, 1>, typename Ref::template units<1, 1>>::value,
+                "Linear quantities must have the units of the reference.");
+  using s = std::ratio_divide<typename U::scale, typename Ref::scale>;
+  const double log2_scale = std::log2(double(s::num) / double(s::den));
+  const double factor = Kind::kFactor * 0.30102999566398120;  // kFactor * log10(2)
+  for (size_t i = 0; i < n; ++i) {
+    const double x = static_cast<double>(linear[i].GetValue());
+    const double db = factor * (detail::FastLog2(x) + log2_scale);
+    out[i] = Level<Ref, Kind>(x > 0.0 ? db : -std::numeric_limits<double>::infinity());
+  }
+}
+
+/**
+ * @~english
+ * Converts an array of levels into linear quantities.
+ * @param levels The levels.
+ * @param out The linear quantities, in any ratio of the reference units.
+ * @param n The number of elements.
+ */
+template <typename Ref, typename Kind, typename U>
+void ToLinear(const Level<Ref, Kind>* levels, U* out, size_t n) noexcept {
+  static_assert(std::is_same<typename U::template units<1, 1>, typename Ref::template units<1, 1>>::value,
+                "Linear quantities must have the units of the reference.");
+  using s = std::ratio_divide<typename Ref::scale, typename U::scale>;
+  const double log2_scale = std::log2(double(s::num) / double(s::den));
+  const double factor = 3.3219280948873623 / Kind::kFactor;  // log2(10) / kFactor
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = U(static_cast<typename U::value_type>(detail::FastExp2(levels[i].GetValue() * factor + log2_scale)));
+  }
+}
+
+/**
+ * @~english
+ * Applies a gain to every level of an array in place.
+ * @param levels The levels.
+ * @param n The number of elements.
+ * @param gain The gain added to each level.
+ */
+template <typename Ref, typename Kind>
+void ApplyGain(Level<Ref, Kind>* levels, size_t n, Decibel gain) noexcept {
+  for (size_t i = 0; i < n; ++i) {
+    levels[i] += gain;
+  }
+}
+
+}  // namespace units
@@ -0,0 +1,73 @@
+#pragma once
+/**
+ * @~english
+ * @file dimensions.hpp
+ * @brief Runtime description of a Unit's exponents and ratio, for units only known at run time.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Runtime counterpart of a Unit's exponents and ratio.
+ */
+struct Dimensions {
+  /**
+   * @~english
+   * Exponents of time, distance, luminance, temperature, radians, amperes and mass, in Unit's parameter order.
+   */
+  std::array<int32_t, 7> exponents;
+
+  /**
+   * @~english
+   * The ratio, as a floating point factor.
+   */
+  double scale;
+
+  /**
+   * @~english
+   * Gets the dimensions of a Unit type.
+   */
+  template <typename U>
+  static Dimensions Of() noexcept;
+
+  bool SameUnits(const Dimensions& other) const noexcept { return exponents == other.exponents; }
+
+  Dimensions operator*(const Dimensions& other) const noexcept {
+    Dimensions result{{}, scale * other.scale};
+    for (size_t i = 0; i < exponents.size(); ++i) result.exponents[i] = exponents[i] + other.exponents[i];
+    return result;
+  }
+
+  Dimensions operator/(const Dimensions& other) const noexcept {
+    Dimensions result{{}, scale / other.scale};
+    for (size_t i = 0; i < exponents.size(); ++i) result.exponents[i] = exponents[i] - other.exponents[i];
+    return result;
+  }
+};
+
+namespace detail {
+
+template <typename U>
+struct DimensionsOf;
+
+template <typename V, int32_t S, int32_t M, int32_t C, int32_t K, int32_t Rad, int32_t A, int32_t KG, size_t Num,
+          size_t Denom>
+struct DimensionsOf<Unit<V, S, M, C, K, Rad, A, KG, Num, Denom>> {
+  static Dimensions Get() noexcept { return {{{S, M, C, K, Rad, A, KG}}, double(Num) / double(Denom)}; }
+};
+
+}  // namespace detail
+
+template <typename U>
+Dimensions Dimensions::Of() noexcept {
+  return detail::DimensionsOf<U>::Get();
+}
+
+}  // namespace units
@@ -0,0 +1,235 @@
+#pragma once
+/**
+ * @~english
+ * @file dual.hpp
+ * @brief Forward-mode automatic differentiation through dual numbers usable as the value type of a Unit.
+ *
+ * A Dual<T, N> carries a value and N directional derivatives stored contiguously, so a single evaluation yields a full
+ * row of a Jacobian. Derivative() returns the derivative as the Unit quotient of the result and the variable, e.g.
+ * d energy / d length is a force.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Dual number with N derivative directions.
+ */
+template <typename T, size_t N = 1>
+class Dual {
+ public:
+  static_assert(std::is_floating_point<T>::value, "Only floating point dual numbers supported.");
+  static_assert(N > 0, "At least one derivative direction required.");
+
+  /**
+   * @~english
+   * The floating point type of the value and derivatives.
+   */
+  using value_type = T;
+
+  /**
+   * @~english
+   * Number of derivative directions.
+   */
+  static constexpr size_t kDirections = N;
+
+  Dual() = default;
+
+  /**
+   * @~english
+   * Constant constructor. All derivatives are zero.
+   * @param value The value.
+   */
+  constexpr Dual(T value) : value_(value), derivs_{} {}
+
+  /**
+   * @~english
+   * Creates an independent variable.
+   * @param value The value.
+   * @param direction The derivative direction seeded with one.
+   * @return The dual number.
+   */
+  static Dual Variable(T value, size_t direction = 0) noexcept {
+    Dual d(value);
+    d.derivs_[direction] = T(1);
+    return d;
+  }
+
+  /**
+   * @~english
+   * Gets the value.
+   * @return The value.
+   */
+  constexpr T GetValue() const noexcept { return value_; }
+
+  /**
+   * @~english
+   * Gets a derivative.
+   * @param direction The derivative direction.
+   * @return The derivative in the given direction.
+   */
+  constexpr T GetDerivative(size_t direction = 0) const noexcept { return derivs_[direction]; }
+
+  /**
+   * @~english
+   * Gets the contiguous derivative lanes.
+   * @return Pointer to the N derivatives.
+   */
+  const T* Derivatives() const noexcept { return derivs_; }
+
+  /**
+   * @~english
+   * Applies the chain rule for a unary function f.
+   * @param f The value f(x).
+   * @param df The derivative f'(x).
+   * @return The dual number f(*this).
+   */
+  Dual Chain(T f, T df) const noexcept {
+    Dual r(f);
+    for (size_t i = 0; i < N; ++i) r.derivs_[i] = df * derivs_[i];
+    return r;
+  }
+
+  Dual operator-() const noexcept { return Chain(-value_, T(-1)); }
+
+  Dual& operator+=(const Dual& other) noexcept {
+    value_ += other.value_;
+    for (size_t i = 0; i < N; ++i) derivs_[i] += other.derivs_[i];
+    return *this;
+  }
+
+  Dual& operator-=(const Dual& other) noexcept {
+    value_ -= other.value_;
+    for (size_t i = 0; i < N; ++i) derivs_[i] -= other.derivs_[i];
+    return *this;
+  }
+
+  Dual& operator*=(const Dual& other) noexcept {
+    for (size_t i = 0; i < N; ++i) derivs_[i] = derivs_[i] * other.value_ + value_ * other.derivs_[i];
+    value_ *= other.value_;
+    return *this;
+  }
+
+  Dual& operator/=(const Dual& other) noexcept {
+    const T inv = T(1) / other.value_;
+    const T q = value_ * inv;
+    for (size_t i = 0; i < N; ++i) derivs_[i] = (derivs_[i] - q * other.derivs_[i]) * inv;
+    value_ = q;
+    return *this;
+  }
+
+  friend Dual operator+(Dual a, const Dual& b) noexcept { return a += b; }
+  friend Dual operator-(Dual a, const Dual& b) noexcept { return a -= b; }
+  friend Dual operator*(Dual a, const Dual& b) noexcept { return a *= b; }
+  friend Dual operator/(Dual a, const Dual& b) noexcept { return a /= b; }
+
+  /**
+   * @~english
+   * Comparisons only consider the value.
+   */
+  friend constexpr bool operator==(const Dual& a, const Dual& b) noexcept { return a.value_ == b.value_; }
+  friend constexpr bool operator!=(const Dual& a, const Dual& b) noexcept { return a.value_ != b.value_; }
+  friend constexpr bool operator<(const Dual& a, const Dual& b) noexcept { return a.value_ < b.value_; }
+  friend constexpr bool operator>(const Dual& a, const Dual& b) noexcept { return a.value_ > b.value_; }
+  friend constexpr bool operator<=(const Dual& a, const Dual& b) noexcept { return a.value_ <= b.value_; }
+  friend constexpr bool operator>=(const Dual& a, const Dual& b) noexcept { return a.value_ >= b.value_; }
+
+ private:
+  T value_;
+  T derivs_[N];
+};
+
+/**
+ * @~english
+ * Scalar operations, used by Unit when rescaling between ratios.
+ */
+template <typename T, size_t N, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+Dual<T, N> operator*(const Dual<T, N>& d, S c) noexcept {
+  return d.Chain(d.GetValue() * c, T(c));
+}
+
+template <typename T, size_t N, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+Dual<T, N> operator*(S c, const Dual<T, N>& d) noexcept {
+  return d * c;
+}
+
+template <typename T, size_t N, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+Dual<T, N> operator/(const Dual<T, N>& d, S c) noexcept {
+  return d.Chain(d.GetValue() / c, T(1) / T(c));
+}
+
+template <typename T, size_t N>
+struct is_value_type<Dual<T, N>> : std::true_type {};
+
+template <typename T, size_t N>
+Dual<T, N> sqrt(const Dual<T, N>& d) noexcept {
+  const T r = std::sqrt(d.GetValue());
+  return d.Chain(r, T(0.5) / r);
+}
+
+template <typename T, size_t N>
+Dual<T, N> exp(const Dual<T, N>& d) noexcept {
+  const T e = std::exp(d.GetValue());
+  return d.Chain(e, e);
+}
+
+template <typename T, size_t N>
+Dual<T, N> log(const Dual<T, N>& d) noexcept {
+  return d.Chain(std::log(d.GetValue()), T(1) / d.GetValue());
+}
+
+template <typename T, size_t N>
+Dual<T, N> sin(const Dual<T, N>& d) noexcept {
+  return d.Chain(std::sin(d.GetValue()), std::cos(d.GetValue()));
+}
+
+template <typename T, size_t N>
+Dual<T, N> cos(const Dual<T, N>& d) noexcept {
+  return d.Chain(std::cos(d.GetValue()), -std::sin(d.GetValue()));
+}
+
+/**
+ * @~english
+ * Creates a unit-typed independent variable.
+ * @param u The value of the variable.
+ * @param direction The derivative direction seeded with one.
+ * @return The unit with a dual value type.
+ */
+template <size_t N = 1, typename U>
+typename U::template rebind<Dual<typename U::value_type, N>> MakeVariable(const U& u, size_t direction = 0) noexcept {
+  return Dual<typename U::value_type, N>::Variable(u.GetValue(), direction);
+}
+
+/**
+ * @~english
+ * Strips the derivatives from a unit with a dual value type.
+ * @param y The unit with a dual value type.
+ * @return The unit with the plain value.
+ */
+template <typename Y, typename T = typename Y::value_type::value_type>
+typename Y::template rebind<T> Value(const Y& y) noexcept {
+  return y.GetValue().GetValue();
+}
+
+/**
+ * @~english
+ * Extracts a derivative as a typed unit.
+ * @param y The dependent unit.
+ * @param x The independent variable, only used for its type.
+ * @param direction The derivative direction x was seeded in.
+ * @return dy/dx, typed as the Unit quotient of y and x.
+ */
+template <typename Y, typename X, typename T = typename Y::value_type::value_type>
+auto Derivative(const Y& y, const X& x, size_t direction = 0) noexcept
+    -> decltype(std::declval<typename Y::template rebind<T>>() / std::declval<typename X::template rebind<T>>()) {
+  (void)x;
+  return {y.GetValue().GetDerivative(direction)};
+}
+
+}  // namespace units
@@ -0,0 +1,333 @@
+#pragma once
+/**
+ * @~english
+ * @file export.hpp
+ * @brief Parallel CSV/TSV export of unit columns, with unit symbols generated at compile time.
+ *
+ * Rows are cut into blocks. Each thread formats whole blocks into its own reusable buffer, and buffers are written
+ * out in block order, so the output is identical for any thread count. Values are formatted into a stack buffer and
+ * appended to the thread's buffer, so there is no heap allocation per value. Floating point values use std::to_chars
+ * when the standard library provides it for floating point, and snprintf otherwise.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv>
+#endif
+#endif
+
+#include "parallel.hpp"
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Fixed-capacity character buffer usable in constant expressions. Appending returns a new buffer, so symbols are
+ * built by C++11 constexpr functions. Text beyond the capacity is dropped.
+ */
+struct SymbolBuffer {
+  char data[128];
+  size_t size;
+
+  constexpr SymbolBuffer() : data{}, size(0) {}
+
+  constexpr SymbolBuffer Append(const char* s) const {
+    return SymbolBuffer(*this, s, Length(s) < sizeof(data) - 1 - size ? size + Length(s) : sizeof(data) - 1,
+                        typename detail::MakeIndexList<sizeof(data)>::type());
+  }
+
+  constexpr SymbolBuffer AppendInt(intmax_t v) const {
+    return v < 0 ? Append("-").AppendDigits(uintmax_t(0) - uintmax_t(v)) : AppendDigits(uintmax_t(v));
+  }
+
+  constexpr const char* c_str() const { return data; }
+
+ private:
+  template <size_t... I>
+  constexpr SymbolBuffer(const SymbolBuffer& base, const char* s, size_t length, detail::IndexList<I...>)
+      : data{(I < base.size ? base.data[I] : I < length ? s[I - base.size] : '\0')...}, size(length) {}
+
+  static constexpr size_t Length(const char* s) { return *s == '\0' ? 0 : 1 + Length(s + 1); }
+
+  constexpr SymbolBuffer AppendDigits(uintmax_t u) const {
+    return u < 10 ? Append(kDigits + 2 * u) : AppendDigits(u / 10).AppendDigits(u % 10);
+  }
+
+  // Every digit followed by a terminator, so that a digit is a string of its own.
+  static constexpr const char* kDigits = "0\0" "1\0" "2\0" "3\0" "4\0" "5\0" "6\0" "7\0" "8\0" "9";
+};
+
+namespace detail {
+
+struct SymbolPrefix {
+  const char* symbol;
+  intmax_t num;
+  intmax_t den;
+};
+
+constexpr SymbolPrefix kSymbolPrefixes[] = {
+    {"a", 1, 1000000000000000000}, {"f", 1, 1000000000000000}, {"p", 1, 1000000000000}, {"n", 1, 1000000000},
+    {"u", 1, 1000000},  {"m", 1, 1000}, {"c", 1, 100}, {"d", 1, 10}, {"da", 10, 1}, {"h", 100, 1}, {"k", 1000, 1},
+    {"M", 1000000, 1}, {"G", 1000000000, 1}, {"T", 1000000000000, 1}, {"P", 1000000000000000, 1},
+    {"E", 1000000000000000000, 1}};
+
+constexpr size_t kSymbolPrefixCount = sizeof(kSymbolPrefixes) / sizeof(kSymbolPrefixes[0]);
+
+// Bases in print order, as indices into Unit's exponent order.
+constexpr size_t kSymbolOrder[7] = {6, 1, 0, 5, 3, 2, 4};
+constexpr const char* kSymbolNames[7] = {"s", "m", "cd", "K", "rad", "A", "g"};
+
+/**
+ * @~english
+ * Checks whether prefix^e equals num / den without overflowing, n / d being the power built so far.
+ */
+constexpr bool PrefixPowerIs(const SymbolPrefix& p, int32_t e, intmax_t num, intmax_t den, intmax_t n = 1,
+                             intmax_t d = 1) {
+  return e <= 0 ? n == num && d == den
+                : n <= num / p.num && d <= den / p.den && PrefixPowerIs(p, e - 1, num, den, n * p.num, d * p.den);
+}
+
+/**
+ * @~english
+ * Where the ratio of a symbol went: into the prefix of base, or, when not placed, into a leading factor.
+ */
+struct SymbolPlacement {
+  bool placed;
+  size_t base;
+  const char* prefix;
+};
+
+/**
+ * @~english
+ * Finds the first base, in print order, and the first prefix that carry the ratio, trying base k with prefix j next.
+ */
+constexpr SymbolPlacement PlaceRatio(const int32_t (&exponents)[7], intmax_t num, intmax_t den, size_t k = 0,
+                                     size_t j = 0) {
+  return num == den ? SymbolPlacement{true, 7, ""}
+         : k == 7   ? SymbolPlacement{false, 7, ""}
+         : j == kSymbolPrefixCount
+             ? PlaceRatio(exponents, num, den, k + 1, 0)
+         : (exponents[kSymbolOrder[k]] > 0 &&
+            PrefixPowerIs(kSymbolPrefixes[j], exponents[kSymbolOrder[k]], num, den)) ||
+                   (exponents[kSymbolOrder[k]] < 0 &&
+                    PrefixPowerIs(kSymbolPrefixes[j], -exponents[kSymbolOrder[k]], den, num))
+             ? SymbolPlacement{true, kSymbolOrder[k], kSymbolPrefixes[j].symbol}
+             : PlaceRatio(exponents, num, den, k, j + 1);
+}
+
+constexpr SymbolBuffer AppendFactor(const SymbolBuffer& s, const SymbolPlacement& placement, intmax_t num,
+                                    intmax_t den) {
+  return placement.placed ? s
+         : den != 1       ? s.Append("(").AppendInt(num).Append("/").AppendInt(den).Append(")")
+                          : s.Append("(").AppendInt(num).Append(")");
+}
+
+constexpr SymbolBuffer AppendBase(const SymbolBuffer& s, const SymbolPlacement& placement, size_t b, int32_t e) {
+  return e != 1 ? AppendBase(s, placement, b, 1).Append("^").AppendInt(e)
+                : s.Append(placement.base == b ? placement.prefix : "").Append(kSymbolNames[b]);
+}
+
+constexpr SymbolBuffer AppendNumerator(const SymbolBuffer& s, const int32_t (&exponents)[7],
+                                       const SymbolPlacement& placement, size_t k = 0, bool numerator = false) {
+  return k == 7 ? (!numerator && placement.placed ? s.Append("1") : s)
+         : exponents[kSymbolOrder[k]] <= 0
+             ? AppendNumerator(s, exponents, placement, k + 1, numerator)
+             : AppendNumerator(AppendBase(numerator || !placement.placed ? s.Append("*") : s, placement,
+                                          kSymbolOrder[k], exponents[kSymbolOrder[k]]),
+                               exponents, placement, k + 1, true);
+}
+
+constexpr SymbolBuffer AppendDenominator(const SymbolBuffer& s, const int32_t (&exponents)[7],
+                                         const SymbolPlacement& placement, size_t k = 0) {
+  return k == 7 ? s
+         : exponents[kSymbolOrder[k]] >= 0
+             ? AppendDenominator(s, exponents, placement, k + 1)
+             : AppendDenominator(AppendBase(s.Append("/"), placement, kSymbolOrder[k], -exponents[kSymbolOrder[k]]),
+                                 exponents, placement, k + 1);
+}
+
+constexpr SymbolBuffer MakeSymbol(const int32_t (&exponents)[7], const SymbolPlacement& placement, intmax_t num,
+                                  intmax_t den) {
+  return AppendDenominator(AppendNumerator(AppendFactor(SymbolBuffer(), placement, num, den), exponents, placement),
+                           exponents, placement);
+}
+
+/**
+ * @~english
+ * Builds a symbol such as "kg*m^2/s^3/A". The ratio becomes an SI prefix on the first base unit that can carry it
+ * (mass first, so kilograms read "kg"); otherwise it is written as a leading factor, e.g. "(127/5000)*m".
+ */
+constexpr SymbolBuffer MakeSymbol(const int32_t (&exponents)[7], intmax_t num, intmax_t den) {
+  return MakeSymbol(exponents, PlaceRatio(exponents, num, den), num, den);
+}
+
+template <typename U>
+struct UnitSymbolOf;
+
+template <typename V, int32_t S, int32_t M, int32_t C, int32_t K, int32_t Rad, int32_t A, int32_t KG, size_t Num,
+          size_t Denom>
+struct UnitSymbolOf<Unit<V, S, M, C, K, Rad, A, KG, Num, Denom>> {
+  static constexpr int32_t kExponents[7] = {S, M, C, K, Rad, A, KG};
+  static constexpr SymbolBuffer value = MakeSymbol(kExponents, Num, Denom);
+};
+
+template <typename V, int32_t S, int32_t M, int32_t C, int32_t K, int32_t Rad, int32_t A, int32_t KG, size_t Num,
+          size_t Denom>
+constexpr int32_t UnitSymbolOf<Unit<V, S, M, C, K, Rad, A, KG, Num, Denom>>::kExponents[7];
+
+template <typename V, int32_t S, int32_t M, int32_t C, int32_t K, int32_t Rad, int32_t A, int32_t KG, size_t Num,
+          size_t Denom>
+constexpr SymbolBuffer UnitSymbolOf<Unit<V, S, M, C, K, Rad, A, KG, Num, Denom>>::value;
+
+}  // namespace detail
+
+/**
+ * @~english
+ * Gets the symbol of a unit, e.g. "km", "m/s^2" or "kg*m^2/s^3/A". Generated at compile time.
+ * @return The symbol, with static storage duration.
+ */
+template <typename U>
+constexpr const char* UnitSymbol() noexcept {
+  return detail::UnitSymbolOf<U>::value.c_str();
+}
+
+/**
+ * @~english
+ * @brief Options of a text export.
+ */
+struct ExportOptions {
+  /** Field separator, e.g. ',' for CSV or '\t' for TSV. */
+  char delimiter = ',';
+  /** Digits after the decimal point for floating point values, or -1 for the shortest round-trip form. */
+  int precision = -1;
+  /** Whether to write a header line of "name [symbol]" fields. */
+  bool header = true;
+  /** Rows per block handed to a thread. */
+  size_t block_rows = 1 << 14;
+  /** Number of threads. Zero uses the hardware concurrency. */
+  unsigned threads = 0;
+};
+
+namespace detail {
+
+/**
+ * @~english
+ * Formats an integer into buffer, returning the end.
+ */
+template <typename T>
+char* FormatValue(T value, int, char* buffer, std::true_type) noexcept {
+  char digits[24];
+  size_t n = 0;
+  using U = typename std::make_unsigned<T>::type;
+  U u = value < 0 ? U(0) - U(value) : U(value);
+  do {
+    digits[n++] = char('0' + u % 10);
+    u /= 10;
+  } while (u != 0);
+  if (value < 0) *buffer++ = '-';
+  while (n > 0) *buffer++ = digits[--n];
+  return buffer;
+}
+
+/**
+ * @~english
+ * Size of the stack buffer a value is formatted into.
+ */
+constexpr size_t kFormatBuffer = 128;
+
+/**
+ * @~english
+ * Formats a floating point value into buffer, returning the end. Fixed precision values that do not fit in the buffer
+ * are written in the shortest round-trip form instead.
+ */
+template <typename T>
+char* FormatValue(T value, int precision, char* buffer, std::false_type) noexcept {
+#if defined(__cpp_lib_to_chars)
+  if (precision >= 0) {
+    const auto fixed = std::to_chars(buffer, buffer + kFormatBuffer, value, std::chars_format::fixed, precision);
+    if (fixed.ec == std::errc()) return fixed.ptr;
+  }
+  return std::to_chars(buffer, buffer + kFormatBuffer, value).ptr;
+#else
+  if (precision >= 0) {
+    const int n = std::snprintf(buffer, kFormatBuffer, "%.*f", precision, double(value));
+    if (n >= 0 && size_t(n) < kFormatBuffer) return buffer + n;
+  }
+  return buffer + std::snprintf(buffer, kFormatBuffer, "%.*g", std::numeric_limits<T>::max_digits10, double(value));
+#endif
+}
+
+template <typename U>
+void AppendValue(std::string* out, const U& value, int precision) {
+  using T = typename U::value_type;
+  static_assert(std::is_arithmetic<T>::value, "Only arithmetic value types can be exported.");
+  char buffer[kFormatBuffer];
+  char* end = FormatValue(value.GetValue(), precision, buffer, std::is_integral<T>());
+  out->append(buffer, end);
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * Writes unit columns as delimited text.
+ * @param out The stream written to.
+ * @param names The column names, one per column. Throws std::invalid_argument if their number differs.
+ * @param n The number of rows.
+ * @param options The format and threading options.
+ * @param columns The columns, each of n units.
+ */
+template <typename... Columns>
+void ExportColumns(std::ostream& out, const std::vector<std::string>& names, size_t n, const ExportOptions& options,
+                   const Columns*... columns) {
+  if (names.size() != sizeof...(Columns)) throw std::invalid_argument("one column name per column expected");
+  const char* const symbols[] = {UnitSymbol<Columns>()...};
+  if (options.header) {
+    std::string header;
+    for (size_t c = 0; c < sizeof...(Columns); ++c) {
+      if (c > 0) header += options.delimiter;
+      header += names[c] + " [" + symbols[c] + "]";
+    }
+    header += '\n';
+    out.write(header.data(), header.size());
+  }
+
+  const size_t block = std::max<size_t>(1, options.block_rows);
+  const size_t blocks = (n + block - 1) / block;
+  const unsigned threads = static_cast<unsigned>(std::min<size_t>(detail::ThreadCount(options.threads),
+                                                                  std::max<size_t>(1, blocks)));
+  std::vector<std::string> buffers(threads);
+  for (size_t first = 0; first < blocks; first += threads) {
+    const unsigned tasks = static_cast<unsigned>(std::min<size_t>(threads, blocks - first));
+    detail::ParallelTasks(tasks, [&](unsigned t) {
+      std::string& buffer = buffers[t];
+      buffer.clear();
+      const size_t begin = (first + t) * block;
+      const size_t end = std::min(n, begin + block);
+      for (size_t row = begin; row < end; ++row) {
+        bool leading = true;
+        int expand[] = {0, ((leading ? void() : buffer.push_back(options.delimiter)), leading = false,
+                            detail::AppendValue(&buffer, columns[row], options.precision), 0)...};
+        (void)expand;
+        buffer.push_back('\n');
+      }
+    });
+    for (unsigned t = 0; t < tasks; ++t) {
+      out.write(buffers[t].data(), buffers[t].size());
+    }
+  }
+}
+
+}  // namespace units
@@ -0,0 +1,310 @@
+#pragma once
+/**
+ * @~english
+ * @file fixed_buffer.hpp
+ * @brief Fixed-capacity buffers and rings of units for real-time threads.
+ *
+ * Storage is inline and sized at compile time, so no operation allocates, locks or throws. Full buffers reject or
+ * overwrite instead of growing, and bulk operations report how many units they moved. Units of any ratio are accepted
+ * and converted into the stored ratio with the factor folded at compile time; other dimensions do not compile.
+ * SpscRing hands units from one thread to another with a bounded number of steps on both sides.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+#include "seqlock.hpp"
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Vector-like buffer of at most N units with inline storage.
+ */
+template <typename U, size_t N>
+class FixedBuffer {
+ public:
+  static_assert(N > 0, "A buffer holds at least one unit.");
+  static_assert(std::is_trivially_copyable<U>::value, "Only trivially copyable units can be buffered.");
+
+  FixedBuffer() noexcept : size_(0) {}
+
+  /**
+   * @~english
+   * Gets the capacity.
+   */
+  static constexpr size_t Capacity() noexcept { return N; }
+
+  size_t Size() const noexcept { return size_; }
+  bool Empty() const noexcept { return size_ == 0; }
+  bool Full() const noexcept { return size_ == N; }
+
+  const U* Data() const noexcept { return data_; }
+  U* Data() noexcept { return data_; }
+  const U* begin() const noexcept { return data_; }
+  const U* end() const noexcept { return data_ + size_; }
+
+  /**
+   * @~english
+   * Gets a unit by index. The index must be below Size().
+   */
+  const U& operator[](size_t i) const noexcept { return data_[i]; }
+  U& operator[](size_t i) noexcept { return data_[i]; }
+
+  /**
+   * @~english
+   * Appends a unit, converted into the ratio of U.
+   * @return False if the buffer is full, in which case it is unchanged.
+   */
+  template <typename V>
+  bool PushBack(const V& u) noexcept {
+    if (size_ == N) return false;
+    Convert(&u, data_ + size_, 1);
+    ++size_;
+    return true;
+  }
+
+  /**
+   * @~english
+   * Appends as many units as fit, converted into the ratio of U.
+   * @param values The units.
+   * @param n The number of units.
+   * @return The number of units appended.
+   */
+  template <typename V>
+  size_t Append(const V* values, size_t n) noexcept {
+    const size_t count = std::min(n, N - size_);
+    Convert(values, data_ + size_, count);
+    size_ += count;
+    return count;
+  }
+
+  /**
+   * @~english
+   * Removes the last unit.
+   * @param u Receives the unit.
+   * @return False if the buffer is empty.
+   */
+  bool PopBack(U* u) noexcept {
+    if (size_ == 0) return false;
+    *u = data_[--size_];
+    return true;
+  }
+
+  void Clear() noexcept { size_ = 0; }
+
+ private:
+  U data_[N];
+  size_t size_;
+};
+
+/**
+ * @~english
+ * @brief FIFO ring of at most N units with inline storage, for use by a single thread.
+ */
+template <typename U, size_t N>
+class FixedRing {
+ public:
+  static_assert(N > 0, "A ring holds at least one unit.");
+  static_assert(std::is_trivially_copyable<U>::value, "Only trivially copyable units can be buffered.");
+
+  FixedRing() noexcept : head_(0), size_(0) {}
+
+  static constexpr size_t Capacity() noexcept { return N; }
+
+  size_t Size() const noexcept { return size_; }
+  bool Empty() const noexcept { return size_ == 0; }
+  bool Full() const noexcept { return size_ == N; }
+
+  /**
+   * @~english
+   * Gets a unit by age, 0 being the oldest. The index must be below Size().
+   */
+  const U& operator[](size_t i) const noexcept { return data_[Wrap(head_ + i)]; }
+
+  /**
+   * @~english
+   * Appends a unit, converted into the ratio of U.
+   * @return False if the ring is full, in which case it is unchanged.
+   */
+  template <typename V>
+  bool Push(const V& u) noexcept {
+    if (size_ == N) return false;
+    Convert(&u, data_ + Wrap(head_ + size_), 1);
+    ++size_;
+    return true;
+  }
+
+  /**
+   * @~english
+   * Appends a unit, dropping the oldest one if the ring is full.
+   * @return False if a unit was dropped.
+   */
+  template <typename V>
+  bool PushOverwrite(const V& u) noexcept {
+    const bool full = size_ == N;
+    Convert(&u, data_ + Wrap(head_ + size_), 1);
+    if (full) {
+      head_ = Wrap(head_ + 1);
+    } else {
+      ++size_;
+    }
+    return !full;
+  }
+
+  /**
+   * @~english
+   * Appends as many units as fit, converted into the ratio of U.
+   * @param values The units.
+   * @param n The number of units.
+   * @return The number of units appended.
+   */
+  template <typename V>
+  size_t Push(const V* values, size_t n) noexcept {
+    const size_t count = std::min(n, N - size_);
+    const size_t tail = Wrap(head_ + size_);
+    const size_t first = std::min(count, N - tail);
+    Convert(values, data_ + tail, first);
+    Convert(values + first, data_, count - first);
+    size_ += count;
+    return count;
+  }
+
+  /**
+   * @~english
+   * Removes the oldest unit.
+   * @param u Receives the unit.
+   * @return False if the ring is empty.
+   */
+  bool Pop(U* u) noexcept {
+    if (size_ == 0) return false;
+    *u = data_[head_];
+    head_ = Wrap(head_ + 1);
+    --size_;
+    return true;
+  }
+
+  /**
+   * @~english
+   * Removes up to n of the oldest units, in order.
+   * @param values Receives the units.
+   * @param n The maximum number of units.
+   * @return The number of units removed.
+   */
+  size_t Pop(U* values, size_t n) noexcept {
+    const size_t count = std::min(n, size_);
+    const size_t first = std::min(count, N - head_);
+    std::copy(data_ + head_, data_ + head_ + first, values);
+    std::copy(data_, data_ + (count - first), values + first);
+    head_ = Wrap(head_ + count);
+    size_ -= count;
+    return count;
+  }
+
+  void Clear() noexcept {
+    head_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  static size_t Wrap(size_t i) noexcept { return i < N ? i : i - N; }
+
+  U data_[N];
+  size_t head_;
+  size_t size_;
+};
+
+/**
+ * @~english
+ * @brief Wait-free FIFO ring of at most N units from one producer thread to one consumer thread.
+ *
+ * N must be a power of two. The producer and consumer positions sit on separate cache lines, and each side reads the
+ * other's position once per call, so bulk calls cost two atomic loads and one store however many units they move.
+ */
+template <typename U, size_t N>
+class SpscRing {
+ public:
+  static_assert(N > 0 && (N & (N - 1)) == 0, "The capacity of a SpscRing is a power of two.");
+  static_assert(std::is_trivially_copyable<U>::value, "Only trivially copyable units can be buffered.");
+
+  SpscRing() noexcept : head_(0), tail_(0) {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  static constexpr size_t Capacity() noexcept { return N; }
+
+  /**
+   * @~english
+   * Gets the number of buffered units. Exact only on the producer or consumer thread when the other is idle.
+   */
+  size_t Size() const noexcept {
+    const size_t head = head_.load(std::memory_order_acquire);
+    return tail_.load(std::memory_order_acquire) - head;
+  }
+
+  /**
+   * @~english
+   * Appends a unit, converted into the ratio of U. Producer thread only.
+   * @return False if the ring is full.
+   */
+  template <typename V>
+  bool Push(const V& u) noexcept {
+    return Push(&u, 1) == 1;
+  }
+
+  /**
+   * @~english
+   * Appends as many units as fit, converted into the ratio of U. Producer thread only.
+   * @param values The units.
+   * @param n The number of units.
+   * @return The number of units appended.
+   */
+  template <typename V>
+  size_t Push(const V* values, size_t n) noexcept {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t count = std::min(n, N - (tail - head_.load(std::memory_order_acquire)));
+    const size_t at = tail & (N - 1);
+    const size_t first = std::min(count, N - at);
+    Convert(values, data_ + at, first);
+    Convert(values + first, data_, count - first);
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  /**
+   * @~english
+   * Removes the oldest unit. Consumer thread only.
+   * @param u Receives the unit.
+   * @return False if the ring is empty.
+   */
+  bool Pop(U* u) noexcept { return Pop(u, 1) == 1; }
+
+  /**
+   * @~english
+   * Removes up to n of the oldest units, in order. Consumer thread only.
+   * @param values Receives the units.
+   * @param n The maximum number of units.
+   * @return The number of units removed.
+   */
+  size_t Pop(U* values, size_t n) noexcept {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t count = std::min(n, tail_.load(std::memory_order_acquire) - head);
+    const size_t at = head & (N - 1);
+    const size_t first = std::min(count, N - at);
+    std::copy(data_ + at, data_ + at + first, values);
+    std::copy(data_, data_ + (count - first), values + first);
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+ private:
+  alignas(kCacheLineSize) std::atomic<size_t> head_;
+  alignas(kCacheLineSize) std::atomic<size_t> tail_;
+  alignas(kCacheLineSize) U data_[N];
+};
+
+}  // namespace units
@@ -0,0 +1,400 @@
+#pragma once
+/**
+ * @~english
+ * @file formula.hpp
+ * @brief Runtime formulas over named unit columns, dimension checked and compiled to bytecode once.
+ *
+ * Formulas such as "voltage * current / 1000" are parsed against columns with declared units. Dimensions combine with
+ * the exponent algebra of Unit::operator* and operator/, and sums require identical exponents. Ratios never reach the
+ * evaluator: each node remembers the ratio its value is in, products and quotients simply multiply the ratios, and
+ * the constant rescale needed by a sum or by the output unit is folded into the nearest load or constant multiply.
+ * Constant subexpressions are folded as well. The bytecode runs over batches of rows; every instruction is a tight
+ * loop over one batch of a value stack, which vectorizes.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "dimensions.hpp"
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief A named input column of a formula.
+ */
+struct FormulaColumn {
+  std::string name;
+  Dimensions dimensions;
+
+  /**
+   * @~english
+   * Declares a column holding values of unit U.
+   */
+  template <typename U>
+  static FormulaColumn Of(std::string name) {
+    return {std::move(name), Dimensions::Of<U>()};
+  }
+};
+
+/**
+ * @~english
+ * Gets the raw values of a unit column for Formula::Evaluate.
+ * @param column The column.
+ * @return The values, in the ratio of U.
+ */
+template <typename U>
+const typename U::value_type* Values(const U* column) noexcept {
+  static_assert(sizeof(U) == sizeof(typename U::value_type) && std::is_standard_layout<U>::value,
+                "A unit must be layout compatible with its value.");
+  return reinterpret_cast<const typename U::value_type*>(column);
+}
+
+namespace detail {
+
+/**
+ * @~english
+ * @brief Bytecode instruction of a compiled formula. Binary operations pop two batches and push one.
+ */
+struct FormulaInstruction {
+  enum Op : uint8_t { kLoad, kConst, kAdd, kSub, kMul, kDiv, kAddConst, kMulConst, kConstSub, kConstDiv };
+  Op op;
+  uint32_t column;
+  double constant;
+};
+
+/**
+ * @~english
+ * @brief Recursive descent compiler from formula text to bytecode.
+ *
+ * expression := term (('+' | '-') term)*
+ * term       := unary (('*' | '/') unary)*
+ * unary      := '-' unary | primary
+ * primary    := number | name | '(' expression ')'
+ */
+class FormulaCompiler {
+ public:
+  FormulaCompiler(const std::string& text, const std::vector<FormulaColumn>& columns)
+      : text_(text), columns_(columns) {}
+
+  /**
+   * @~english
+   * Compiles the formula, rescaling its result into the given dimensions.
+   * @return True on success. Otherwise error() describes the first problem.
+   */
+  bool Compile(const Dimensions& result) {
+    Operand value;
+    if (!Expression(&value)) return false;
+    Skip();
+    if (pos_ < text_.size()) return Fail("unexpected '" + std::string(1, text_[pos_]) + "'");
+    if (!value.dimensions.SameUnits(result)) return Fail("formula does not have the units of the result");
+    if (value.constant) {
+      Emit({FormulaInstruction::kConst, 0, value.value * value.dimensions.scale / result.scale});
+    } else {
+      Scale(value.dimensions.scale / result.scale);
+    }
+    return true;
+  }
+
+  const std::vector<FormulaInstruction>& code() const noexcept { return code_; }
+  size_t depth() const noexcept { return max_depth_; }
+  const std::string& error() const noexcept { return error_; }
+
+ private:
+  /**
+   * @~english
+   * A compiled subexpression: either a pending constant or code that leaves one batch on the stack.
+   */
+  struct Operand {
+    Dimensions dimensions{{}, 1.0};
+    bool constant = false;
+    double value = 0.0;
+  };
+
+  bool Fail(const std::string& message) {
+    error_ = message + " at offset " + std::to_string(pos_);
+    return false;
+  }
+
+  void Skip() {
+    while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+  }
+
+  bool Accept(char c) {
+    Skip();
+    if (pos_ < text_.size() && text_[pos_] == c) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  void Emit(const FormulaInstruction& instruction) {
+    code_.push_back(instruction);
+    switch (instruction.op) {
+      case FormulaInstruction::kLoad:
+      case FormulaInstruction::kConst:
+        max_depth_ = std::max(max_depth_, ++depth_);
+        break;
+      case FormulaInstruction::kAdd:
+      case FormulaInstruction::kSub:
+      case FormulaInstruction::kMul:
+      case FormulaInstruction::kDiv:
+        --depth_;
+        break;
+      default:
+        break;
+    }
+  }
+
+  /**
+   * @~english
+   * Multiplies the batch on top of the stack by a constant, merging into the previous load or multiply if possible.
+   */
+  void Scale(double factor) {
+    if (factor == 1.0) return;
+    FormulaInstruction& last = code_.back();
+    if (last.op == FormulaInstruction::kLoad || last.op == FormulaInstruction::kMulConst) {
+      last.constant *= factor;
+    } else {
+      Emit({FormulaInstruction::kMulConst, 0, factor});
+    }
+  }
+
+  bool Expression(Operand* out) {
+    if (!Term(out)) return false;
+    for (;;) {
+      const bool add = Accept('+');
+      if (!add && !Accept('-')) return true;
+      Operand right;
+      if (!Term(&right)) return false;
+      if (!out->dimensions.SameUnits(right.dimensions)) return Fail("sum of operands with different units");
+      if (out->constant && right.constant) {
+        const double r = right.value * right.dimensions.scale / out->dimensions.scale;
+        out->value = add ? out->value + r : out->value - r;
+      } else if (right.constant) {
+        const double r = right.value * right.dimensions.scale / out->dimensions.scale;
+        Emit({FormulaInstruction::kAddConst, 0, add ? r : -r});
+      } else if (out->constant) {
+        // Only the right operand's code was emitted; rescale it into the left ratio.
+        Scale(right.dimensions.scale / out->dimensions.scale);
+        const double l = out->value;
+        Emit(add ? FormulaInstruction{FormulaInstruction::kAddConst, 0, l}
+                 : FormulaInstruction{FormulaInstruction::kConstSub, 0, l});
+        out->constant = false;
+      } else {
+        Scale(right.dimensions.scale / out->dimensions.scale);
+        Emit({add ? FormulaInstruction::kAdd : FormulaInstruction::kSub, 0, 0.0});
+      }
+    }
+  }
+
+  bool Term(Operand* out) {
+    if (!Unary(out)) return false;
+    for (;;) {
+      const bool multiply = Accept('*');
+      if (!multiply && !Accept('/')) return true;
+      Operand right;
+      if (!Unary(&right)) return false;
+      const Dimensions dimensions = multiply ? out->dimensions * right.dimensions : out->dimensions / right.dimensions;
+      if (out->constant && right.constant) {
+        out->value = multiply ? out->value * right.value : out->value / right.value;
+      } else if (right.constant) {
+        Scale(multiply ? right.value : 1.0 / right.value);
+      } else if (out->constant) {
+        if (multiply) {
+          Scale(out->value);
+        } else {
+          Emit({FormulaInstruction::kConstDiv, 0, out->value});
+        }
+        out->constant = false;
+      } else {
+        Emit({multiply ? FormulaInstruction::kMul : FormulaInstruction::kDiv, 0, 0.0});
+      }
+      out->dimensions = dimensions;
+    }
+  }
+
+  bool Unary(Operand* out) {
+    if (Accept('-')) {
+      if (!Unary(out)) return false;
+      if (out->constant) {
+        out->value = -out->value;
+      } else {
+        Scale(-1.0);
+      }
+      return true;
+    }
+    return Primary(out);
+  }
+
+  bool Primary(Operand* out) {
+    Skip();
+    if (Accept('(')) {
+      if (!Expression(out)) return false;
+      return Accept(')') ? true : Fail("expected ')'");
+    }
+    if (pos_ >= text_.size()) return Fail("unexpected end of formula");
+    const char c = text_[pos_];
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+      char* end = nullptr;
+      const double value = std::strtod(text_.c_str() + pos_, &end);
+      if (end == text_.c_str() + pos_) return Fail("malformed number");
+      pos_ = end - text_.c_str();
+      out->constant = true;
+      out->value = value;
+      return true;
+    }
+    if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+      const size_t begin = pos_;
+      while (pos_ < text_.size() && (std::isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_')) {
+        ++pos_;
+      }
+      const std::string name = text_.substr(begin, pos_ - begin);
+      for (size_t i = 0; i < columns_.size(); ++i) {
+        if (columns_[i].name == name) {
+          out->dimensions = columns_[i].dimensions;
+          Emit({FormulaInstruction::kLoad, static_cast<uint32_t>(i), 1.0});
+          return true;
+        }
+      }
+      pos_ = begin;
+      return Fail("unknown column '" + name + "'");
+    }
+    return Fail("unexpected '" + std::string(1, c) + "'");
+  }
+
+  const std::string& text_;
+  const std::vector<FormulaColumn>& columns_;
+  size_t pos_ = 0;
+  std::vector<FormulaInstruction> code_;
+  size_t depth_ = 0;
+  size_t max_depth_ = 0;
+  std::string error_;
+};
+
+}  // namespace detail
+
+/**
+ * @~english
+ * @brief A compiled formula producing values of unit Out.
+ */
+template <typename Out>
+class Formula {
+ public:
+  using value_type = typename Out::value_type;
+  static_assert(std::is_floating_point<value_type>::value, "Only floating point formulas supported.");
+
+  /**
+   * @~english
+   * Rows evaluated per instruction dispatch.
+   */
+  static constexpr size_t kBatch = 256;
+
+  /**
+   * @~english
+   * Compiles a formula.
+   * @param expression The formula text over column names, numbers, + - * / and parentheses. Numbers are dimensionless.
+   * @param columns The columns the formula may refer to. Column i is read from columns[i] in Evaluate().
+   * @param formula Receives the compiled formula on success.
+   * @param error Receives a description of the first problem on failure. May be null.
+   * @return True on success.
+   */
+  static bool Compile(const std::string& expression, const std::vector<FormulaColumn>& columns, Formula* formula,
+                      std::string* error = nullptr) {
+    detail::FormulaCompiler compiler(expression, columns);
+    if (!compiler.Compile(Dimensions::Of<Out>())) {
+      if (error != nullptr) *error = compiler.error();
+      return false;
+    }
+    formula->code_ = compiler.code();
+    formula->depth_ = compiler.depth();
+    return true;
+  }
+
+  /**
+   * @~english
+   * Gets the number of bytecode instructions after folding.
+   */
+  size_t Instructions() const noexcept { return code_.size(); }
+
+  /**
+   * @~english
+   * Evaluates the formula over rows.
+   * @param columns The raw values of each declared column, in the ratio it was declared with. See Values().
+   * @param n The number of rows.
+   * @param out The results. Left untouched by a formula that was never compiled.
+   */
+  void Evaluate(const value_type* const* columns, size_t n, Out* out) const {
+    using I = detail::FormulaInstruction;
+    if (code_.empty()) return;
+    std::vector<value_type> stack(depth_ * kBatch);
+    for (size_t row = 0; row < n; row += kBatch) {
+      const size_t m = std::min(kBatch, n - row);
+      size_t sp = 0;
+      for (const I& in : code_) {
+        const value_type c = value_type(in.constant);
+        if (in.op == I::kLoad || in.op == I::kConst) ++sp;
+        value_type* top = stack.data() + (sp - 1) * kBatch;
+        // Binary operations pop top into the batch below it, which exists only when sp >= 2.
+        value_type* a = stack.data() + (sp >= 2 ? sp - 2 : 0) * kBatch;
+        switch (in.op) {
+          case I::kLoad: {
+            const value_type* src = columns[in.column] + row;
+            for (size_t i = 0; i < m; ++i) top[i] = src[i] * c;
+            break;
+          }
+          case I::kConst:
+            for (size_t i = 0; i < m; ++i) top[i] = c;
+            break;
+          case I::kAdd:
+            for (size_t i = 0; i < m; ++i) a[i] += top[i];
+            --sp;
+            break;
+          case I::kSub:
+            for (size_t i = 0; i < m; ++i) a[i] -= top[i];
+            --sp;
+            break;
+          case I::kMul:
+            for (size_t i = 0; i < m; ++i) a[i] *= top[i];
+            --sp;
+            break;
+          case I::kDiv:
+            for (size_t i = 0; i < m; ++i) a[i] /= top[i];
+            --sp;
+            break;
+          case I::kAddConst:
+            for (size_t i = 0; i < m; ++i) top[i] += c;
+            break;
+          case I::kMulConst:
+            for (size_t i = 0; i < m; ++i) top[i] *= c;
+            break;
+          case I::kConstSub:
+            for (size_t i = 0; i < m; ++i) top[i] = c - top[i];
+            break;
+          case I::kConstDiv:
+            for (size_t i = 0; i < m; ++i) top[i] = c / top[i];
+            break;
+        }
+      }
+      const value_type* result = stack.data();
+      for (size_t i = 0; i < m; ++i) out[row + i] = Out(result[i]);
+    }
+  }
+
+ private:
+  std::vector<detail::FormulaInstruction> code_;
+  size_t depth_ = 0;
+};
+
+template <typename Out>
+constexpr size_t Formula<Out>::kBatch;
+
+}  // namespace units
@@ -0,0 +1,321 @@
+#pragma once
+/**
+ * @~english
+ * @file interval.hpp
+ * @brief Interval arithmetic value type giving guaranteed bounds on unit computations.
+ *
+ * Interval<T> can back a Unit, and IntervalUnit<d::Meter> / IntervalUnit<d::Second> is a typed velocity interval.
+ * Bounds are rounded outward either by widening each result by one ulp (RoundOutward, the default, which is cheap and
+ * vectorizes) or by switching the FPU rounding mode (RoundDirected, tight but slow and requires -frounding-math).
+ */
+
+#include <cfenv>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Rounding policy that computes in round-to-nearest and widens the result by at least one ulp.
+ */
+struct RoundOutward {
+  template <typename T>
+  static T Down(T r) noexcept { return r - Ulp(r); }
+
+  template <typename T>
+  static T Up(T r) noexcept { return r + Ulp(r); }
+
+  template <typename F>
+  static auto Lower(F f) noexcept -> decltype(f()) { return Down(f()); }
+
+  template <typename F>
+  static auto Upper(F f) noexcept -> decltype(f()) { return Up(f()); }
+
+ private:
+  /**
+   * @~english
+   * At least one ulp of r. Clamped so infinite bounds stay infinite instead of turning into NaN.
+   */
+  template <typename T>
+  static T Ulp(T r) noexcept {
+    return std::fmin(std::fabs(r), std::numeric_limits<T>::max()) * std::numeric_limits<T>::epsilon() +
+           std::numeric_limits<T>::denorm_min();
+  }
+};
+
+/**
+ * @~english
+ * @brief Rounding policy that evaluates each bound under the matching FPU rounding mode.
+ * Needs -frounding-math (or equivalent) so the compiler does not move arithmetic across mode switches.
+ */
+struct RoundDirected {
+  template <typename F>
+  static auto Lower(F f) noexcept -> decltype(f()) { return Evaluate(f, FE_DOWNWARD); }
+
+  template <typename F>
+  static auto Upper(F f) noexcept -> decltype(f()) { return Evaluate(f, FE_UPWARD); }
+
+ private:
+  template <typename F>
+  static auto Evaluate(F f, int mode) noexcept -> decltype(f()) {
+    const int old = std::fegetround();
+    std::fesetround(mode);
+    const volatile auto r = f();
+    std::fesetround(old);
+    return r;
+  }
+};
+
+/**
+ * @~english
+ * @brief Closed interval [lower, upper].
+ */
+template <typename T, typename Rounding = RoundOutward>
+class Interval {
+ public:
+  static_assert(std::is_floating_point<T>::value, "Only floating point intervals supported.");
+
+  /**
+   * @~english
+   * The floating point type of the bounds.
+   */
+  using value_type = T;
+
+  Interval() = default;
+
+  /**
+   * @~english
+   * Degenerate interval constructor.
+   * @param value The exact value.
+   */
+  constexpr Interval(T value) : lower_(value), upper_(value) {}
+
+  /**
+   * @~english
+   * Constructor
+   * @param lower The lower bound.
+   * @param upper The upper bound.
+   */
+  constexpr Interval(T lower, T upper) : lower_(lower), upper_(upper) {}
+
+  constexpr T GetLower() const noexcept { return lower_; }
+  constexpr T GetUpper() const noexcept { return upper_; }
+  constexpr T GetWidth() const noexcept { return upper_ - lower_; }
+  constexpr T GetMidpoint() const noexcept { return lower_ + (upper_ - lower_) / 2; }
+  constexpr bool Contains(T x) const noexcept { return lower_ <= x && x <= upper_; }
+
+  constexpr Interval operator-() const noexcept { return {-upper_, -lower_}; }
+
+  friend Interval operator+(const Interval& a, const Interval& b) noexcept {
+    return {Rounding::Lower([&] { return a.lower_ + b.lower_; }), Rounding::Upper([&] { return a.upper_ + b.upper_; })};
+  }
+
+  friend Interval operator-(const Interval& a, const Interval& b) noexcept {
+    return {Rounding::Lower([&] { return a.lower_ - b.upper_; }), Rounding::Upper([&] { return a.upper_ - b.lower_; })};
+  }
+
+  friend Interval operator*(const Interval& a, const Interval& b) noexcept {
+    return {Rounding::Lower([&] { return Min4(a.lower_ * b.lower_, a.lower_ * b.upper_,
+                                              a.upper_ * b.lower_, a.upper_ * b.upper_); }),
+            Rounding::Upper([&] { return Max4(a.lower_ * b.lower_, a.lower_ * b.upper_,
+                                              a.upper_ * b.lower_, a.upper_ * b.upper_); })};
+  }
+
+  /**
+   * @~english
+   * Division. A divisor containing zero yields the whole real line.
+   */
+  friend Interval operator/(const Interval& a, const Interval& b) noexcept {
+    if (b.lower_ <= T(0) && b.upper_ >= T(0)) {
+      return {-std::numeric_limits<T>::infinity(), std::numeric_limits<T>::infinity()};
+    }
+    return {Rounding::Lower([&] { return Min4(a.lower_ / b.lower_, a.lower_ / b.upper_,
+                                              a.upper_ / b.lower_, a.upper_ / b.upper_); }),
+            Rounding::Upper([&] { return Max4(a.lower_ / b.lower_, a.lower_ / b.upper_,
+                                              a.upper_ / b.lower_, a.upper_ / b.upper_); })};
+  }
+
+  Interval& operator+=(const Interval& other) noexcept { return *this = *this + other; }
+  Interval& operator-=(const Interval& other) noexcept { return *this = *this - other; }
+  Interval& operator*=(const Interval& other) noexcept { return *this = *this * other; }
+  Interval& operator/=(const Interval& other) noexcept { return *this = *this / other; }
+
+  /**
+   * @~english
+   * Equality compares both bounds. Ordering is certain ordering: a < b only if every point of a is below every
+   * point of b.
+   */
+  friend constexpr bool operator==(const Interval& a, const Interval& b) noexcept {
+    return a.lower_ == b.lower_ && a.upper_ == b.upper_;
+  }
+  friend constexpr bool operator!=(const Interval& a, const Interval& b) noexcept { return !(a == b); }
+  friend constexpr bool operator<(const Interval& a, const Interval& b) noexcept { return a.upper_ < b.lower_; }
+  friend constexpr bool operator>(const Interval& a, const Interval& b) noexcept { return a.lower_ > b.upper_; }
+  friend constexpr bool operator<=(const Interval& a, const Interval& b) noexcept { return a.upper_ <= b.lower_; }
+  friend constexpr bool operator>=(const Interval& a, const Interval& b) noexcept { return a.lower_ >= b.upper_; }
+
+ private:
+  static T Min4(T a, T b, T c, T d) noexcept { return std::fmin(std::fmin(a, b), std::fmin(c, d)); }
+  static T Max4(T a, T b, T c, T d) noexcept { return std::fmax(std::fmax(a, b), std::fmax(c, d)); }
+
+  T lower_;
+  T upper_;
+};
+
+/**
+ * @~english
+ * Scalar operations, used by Unit when rescaling between ratios.
+ */
+template <typename T, typename R, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+Interval<T, R> operator*(const Interval<T, R>& i, S c) noexcept {
+  return i * Interval<T, R>(T(c));
+}
+
+template <typename T, typename R, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+Interval<T, R> operator*(S c, const Interval<T, R>& i) noexcept {
+  return i * Interval<T, R>(T(c));
+}
+
+template <typename T, typename R, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+Interval<T, R> operator/(const Interval<T, R>& i, S c) noexcept {
+  return i / Interval<T, R>(T(c));
+}
+
+template <typename T, typename R>
+struct is_value_type<Interval<T, R>> : std::true_type {};
+
+/**
+ * @~english
+ * The unit U with an interval value type, e.g. IntervalUnit<d::Meter>.
+ */
+template <typename U, typename Rounding = RoundOutward>
+using IntervalUnit = typename U::template rebind<Interval<typename U::value_type, Rounding>>;
+
+/**
+ * @~english
+ * @brief Structure-of-arrays storage for interval units. Lower and upper bounds are separate lanes and the bulk
+ * operations always round outward by widening, so they vectorize.
+ */
+template <typename U>
+class IntervalArray {
+ public:
+  /**
+   * @~english
+   * The floating point type of each lane.
+   */
+  using scalar_type = typename U::value_type::value_type;
+
+  /**
+   * @~english
+   * Constructor
+   * @param size The number of elements, all initialized to [0, 0].
+   */
+  explicit IntervalArray(size_t size = 0) : lower_(size), upper_(size) {}
+
+  size_t Size() const noexcept { return lower_.size(); }
+
+  U Get(size_t i) const noexcept { return U({lower_[i], upper_[i]}); }
+
+  void Set(size_t i, const U& u) noexcept {
+    lower_[i] = u.GetValue().GetLower();
+    upper_[i] = u.GetValue().GetUpper();
+  }
+
+  scalar_type* Lower() noexcept { return lower_.data(); }
+  const scalar_type* Lower() const noexcept { return lower_.data(); }
+  scalar_type* Upper() noexcept { return upper_.data(); }
+  const scalar_type* Upper() const noexcept { return upper_.data(); }
+
+ private:
+  std::vector<scalar_type> lower_;
+  std::vector<scalar_type> upper_;
+};
+
+namespace detail {
+
+template <typename U1, typename U2>
+void CheckSameSize(const IntervalArray<U1>& a, const IntervalArray<U2>& b) {
+  if (a.Size() != b.Size()) throw std::invalid_argument("interval arrays differ in size");
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * Element-wise sum. Operands in different ratios are rescaled to the ratio chosen by Unit::operator+.
+ * @return Array of the summed intervals.
+ * @throws std::invalid_argument If the arrays differ in size.
+ */
+template <typename U1, typename U2, typename R = decltype(std::declval<U1>() + std::declval<U2>())>
+IntervalArray<R> Add(const IntervalArray<U1>& a, const IntervalArray<U2>& b) {
+  detail::CheckSameSize(a, b);
+  using T = typename IntervalArray<R>::scalar_type;
+  using fa = std::ratio_divide<typename U1::scale, typename R::scale>;
+  using fb = std::ratio_divide<typename U2::scale, typename R::scale>;
+  const T ka = T(fa::num) / T(fa::den), kb = T(fb::num) / T(fb::den);
+  IntervalArray<R> out(a.Size());
+  const T *al = a.Lower(), *au = a.Upper(), *bl = b.Lower(), *bu = b.Upper();
+  T *ol = out.Lower(), *ou = out.Upper();
+  for (size_t i = 0; i < out.Size(); ++i) {
+    ol[i] = RoundOutward::Down(RoundOutward::Down(al[i] * ka) + RoundOutward::Down(bl[i] * kb));
+    ou[i] = RoundOutward::Up(RoundOutward::Up(au[i] * ka) + RoundOutward::Up(bu[i] * kb));
+  }
+  return out;
+}
+
+/**
+ * @~english
+ * Element-wise product.
+ * @return Array of the multiplied intervals.
+ * @throws std::invalid_argument If the arrays differ in size.
+ */
+template <typename U1, typename U2, typename R = decltype(std::declval<U1>() * std::declval<U2>())>
+IntervalArray<R> Multiply(const IntervalArray<U1>& a, const IntervalArray<U2>& b) {
+  detail::CheckSameSize(a, b);
+  using T = typename IntervalArray<R>::scalar_type;
+  IntervalArray<R> out(a.Size());
+  const T *al = a.Lower(), *au = a.Upper(), *bl = b.Lower(), *bu = b.Upper();
+  T *ol = out.Lower(), *ou = out.Upper();
+  for (size_t i = 0; i < out.Size(); ++i) {
+    const T p0 = al[i] * bl[i], p1 = al[i] * bu[i], p2 = au[i] * bl[i], p3 = au[i] * bu[i];
+    const T lo01 = p0 < p1 ? p0 : p1, lo23 = p2 < p3 ? p2 : p3;
+    const T hi01 = p0 > p1 ? p0 : p1, hi23 = p2 > p3 ? p2 : p3;
+    ol[i] = RoundOutward::Down(lo01 < lo23 ? lo01 : lo23);
+    ou[i] = RoundOutward::Up(hi01 > hi23 ? hi01 : hi23);
+  }
+  return out;
+}
+
+/**
+ * @~english
+ * Element-wise quotient. Divisors containing zero yield the whole real line.
+ * @return Array of the divided intervals.
+ * @throws std::invalid_argument If the arrays differ in size.
+ */
+template <typename U1, typename U2, typename R = decltype(std::declval<U1>() / std::declval<U2>())>
+IntervalArray<R> Divide(const IntervalArray<U1>& a, const IntervalArray<U2>& b) {
+  detail::CheckSameSize(a, b);
+  using T = typename IntervalArray<R>::scalar_type;
+  constexpr T kInf = std::numeric_limits<T>::infinity();
+  IntervalArray<R> out(a.Size());
+  const T *al = a.Lower(), *au = a.Upper(), *bl = b.Lower(), *bu = b.Upper();
+  T *ol = out.Lower(), *ou = out.Upper();
+  for (size_t i = 0; i < out.Size(); ++i) {
+    const T q0 = al[i] / bl[i], q1 = al[i] / bu[i], q2 = au[i] / bl[i], q3 = au[i] / bu[i];
+    const T lo01 = q0 < q1 ? q0 : q1, lo23 = q2 < q3 ? q2 : q3;
+    const T hi01 = q0 > q1 ? q0 : q1, hi23 = q2 > q3 ? q2 : q3;
+    const bool zero = bl[i] <= T(0) && bu[i] >= T(0);
+    ol[i] = zero ? -kInf : RoundOutward::Down(lo01 < lo23 ? lo01 : lo23);
+    ou[i] = zero ? kInf : RoundOutward::Up(hi01 > hi23 ? hi01 : hi23);
+  }
+  return out;
+}
+
+}  // namespace units
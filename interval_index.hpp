@@ -0,0 +1,165 @@
+#pragma once
+/**
+ * @~english
+ * @file interval_index.hpp
+ * @brief Static interval index over unit-typed ranges, e.g. maintenance windows in time units.
+ *
+ * Intervals are sorted by start with a radix argsort and stored structure-of-arrays. The index is an implicit
+ * augmented tree: the node of the range [lo, hi) is its midpoint and stores the largest end in the range, so there
+ * are no child pointers. Each interval costs two values, one augmented maximum and a 32-bit id.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <type_traits>
+#include <vector>
+
+#include "parallel.hpp"
+#include "sort.hpp"
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Static index of closed intervals [start, end] with endpoints of unit U.
+ */
+template <typename U>
+class IntervalIndex {
+ public:
+  using value_type = typename U::value_type;
+
+  /**
+   * @~english
+   * Builds the index.
+   * @param starts The interval starts.
+   * @param ends The interval ends.
+   * @param n The number of intervals, at most 2^32 - 1. Results are positions in the input arrays.
+   * @param threads The number of threads used for sorting. Zero uses the hardware concurrency.
+   */
+  IntervalIndex(const U* starts, const U* ends, size_t n, unsigned threads = 0)
+      : starts_(n), ends_(n), max_ends_(n), ids_(n) {
+    std::vector<size_t> order(n);
+    RadixArgsort(starts, n, order.data(), threads);
+    for (size_t i = 0; i < n; ++i) {
+      starts_[i] = starts[order[i]].GetValue();
+      ends_[i] = ends[order[i]].GetValue();
+      ids_[i] = static_cast<uint32_t>(order[i]);
+    }
+    Augment(0, n);
+  }
+
+  size_t Size() const noexcept { return ids_.size(); }
+
+  /**
+   * @~english
+   * Finds the intervals containing a point.
+   * @param point The point, in any ratio of U. Converted once per query.
+   * @param out The ids of the matching intervals are appended to out.
+   */
+  template <typename P>
+  void Stab(const P& point, std::vector<uint32_t>* out) const {
+    Overlap(point, point, out);
+  }
+
+  /**
+   * @~english
+   * Finds the intervals overlapping the closed range [lo, hi]. With integral values, a range in a finer ratio than U is
+   * narrowed to the values of U it contains, lo rounded up and hi rounded down, so the test stays exact.
+   * @param lo The start of the range, in any ratio of U.
+   * @param hi The end of the range, in any ratio of U.
+   * @param out The ids of the matching intervals are appended to out.
+   */
+  template <typename P, typename Q>
+  void Overlap(const P& lo, const Q& hi, std::vector<uint32_t>* out) const {
+    static_assert(std::is_same<typename P::template units<1, 1>, typename U::template units<1, 1>>::value &&
+                      std::is_same<typename Q::template units<1, 1>, typename U::template units<1, 1>>::value,
+                  "Queries require identical units and value type.");
+    using slo = std::ratio_divide<typename P::scale, typename U::scale>;
+    using shi = std::ratio_divide<typename Q::scale, typename U::scale>;
+    const value_type qlo = detail::RescaleRounded<slo>(lo.GetValue(), true);
+    const value_type qhi = detail::RescaleRounded<shi>(hi.GetValue(), false);
+    if (qlo > qhi) return;
+    Overlap(qlo, qhi, 0, Size(), out);
+  }
+
+  /**
+   * @~english
+   * Stabbing queries for a batch of points, split across threads.
+   * @param points The points, in any ratio of U.
+   * @param n The number of points.
+   * @param out The ids matching each point. Resized to n.
+   * @param threads The number of threads. Zero uses the hardware concurrency.
+   */
+  template <typename P>
+  void StabBatch(const P* points, size_t n, std::vector<std::vector<uint32_t>>* out, unsigned threads = 0) const {
+    out->assign(n, {});
+    detail::ParallelFor(n, threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) Stab(points[i], &(*out)[i]);
+    });
+  }
+
+  /**
+   * @~english
+   * Overlap queries for a batch of ranges, split across threads.
+   * @param los The range starts, in any ratio of U.
+   * @param his The range ends, in any ratio of U.
+   * @param n The number of ranges.
+   * @param out The ids matching each range. Resized to n.
+   * @param threads The number of threads. Zero uses the hardware concurrency.
+   */
+  template <typename P, typename Q>
+  void OverlapBatch(const P* los, const Q* his, size_t n, std::vector<std::vector<uint32_t>>* out,
+                    unsigned threads = 0) const {
+    out->assign(n, {});
+    detail::ParallelFor(n, threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) Overlap(los[i], his[i], &(*out)[i]);
+    });
+  }
+
+ private:
+  /**
+   * @~english
+   * Ranges at most this large are leaves and scanned linearly.
+   */
+  static constexpr size_t kLeafSize = 16;
+
+  value_type Augment(size_t lo, size_t hi) {
+    if (hi - lo <= kLeafSize) {
+      value_type max = std::numeric_limits<value_type>::lowest();
+      for (size_t i = lo; i < hi; ++i) max = std::max(max, ends_[i]);
+      if (lo < hi) max_ends_[lo + (hi - lo) / 2] = max;
+      return max;
+    }
+    const size_t mid = lo + (hi - lo) / 2;
+    const value_type max = std::max({ends_[mid], Augment(lo, mid), Augment(mid + 1, hi)});
+    max_ends_[mid] = max;
+    return max;
+  }
+
+  void Overlap(value_type qlo, value_type qhi, size_t lo, size_t hi, std::vector<uint32_t>* out) const {
+    if (lo >= hi) return;
+    const size_t mid = lo + (hi - lo) / 2;
+    if (max_ends_[mid] < qlo) return;
+    if (hi - lo <= kLeafSize) {
+      for (size_t i = lo; i < hi && starts_[i] <= qhi; ++i) {
+        if (ends_[i] >= qlo) out->push_back(ids_[i]);
+      }
+      return;
+    }
+    Overlap(qlo, qhi, lo, mid, out);
+    if (starts_[mid] > qhi) return;
+    if (ends_[mid] >= qlo) out->push_back(ids_[mid]);
+    Overlap(qlo, qhi, mid + 1, hi, out);
+  }
+
+  std::vector<value_type> starts_;
+  std::vector<value_type> ends_;
+  std::vector<value_type> max_ends_;
+  std::vector<uint32_t> ids_;
+};
+
+}  // namespace units
@@ -0,0 +1,175 @@
+#pragma once
+/**
+ * @~english
+ * @file join.hpp
+ * @brief As-of and tolerance-window joins between sorted unit columns in different ratios.
+ *
+ * Both columns are compared in the common ratio that Unit::operator+ would pick for them. The two rescale factors
+ * are compile-time constants, so rows are scaled by a constant multiply instead of going through the cross-ratio
+ * comparison operators. Each thread joins a contiguous block of left rows: it binary searches its starting position
+ * once and then gallops forward through the right column.
+ */
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "parallel.hpp"
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Half-open range [begin, end) of matching right rows.
+ */
+struct JoinRange {
+  size_t begin;
+  size_t end;
+};
+
+namespace detail {
+
+/**
+ * @~english
+ * Common ratio of two units with the same dimensions, and the factors that rescale each of them into it.
+ */
+template <typename L, typename R>
+struct JoinScale {
+  using common = decltype(std::declval<L>() + std::declval<R>());
+  using value_type = typename common::value_type;
+  using left = std::ratio_divide<typename L::scale, typename common::scale>;
+  using right = std::ratio_divide<typename R::scale, typename common::scale>;
+  static_assert(left::den == 1 && right::den == 1, "Common ratio must divide both ratios.");
+
+  static constexpr value_type Left(const L& l) noexcept { return l.GetValue() * value_type(left::num); }
+  static constexpr value_type Right(const R& r) noexcept { return r.GetValue() * value_type(right::num); }
+};
+
+/**
+ * @~english
+ * Finds the first index in [from, n) for which the monotone predicate holds, or n. Gallops with doubling steps from
+ * the start position, then binary searches the last step.
+ */
+template <typename P>
+size_t Gallop(size_t from, size_t n, P pred) {
+  size_t lo = from;
+  size_t step = 1;
+  while (lo + step <= n && !pred(lo + step - 1)) {
+    lo += step;
+    step *= 2;
+  }
+  size_t hi = lo + step <= n ? lo + step - 1 : n;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (pred(mid)) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+/**
+ * @~english
+ * Finds the first index in [0, n) for which the monotone predicate holds, or n.
+ */
+template <typename P>
+size_t Partition(size_t n, P pred) {
+  size_t lo = 0;
+  size_t hi = n;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (pred(mid)) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * As-of join: for every left row, finds the last right row at or before it.
+ * @param left The left column, sorted ascending.
+ * @param nl The number of left rows.
+ * @param right The right column, sorted ascending, in any ratio of the same units.
+ * @param nr The number of right rows.
+ * @param match Receives, for each left row, the index of the matching right row, or nr if there is none.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ */
+template <typename L, typename R>
+void AsOfJoin(const L* left, size_t nl, const R* right, size_t nr, size_t* match, unsigned threads = 0) {
+  using s = detail::JoinScale<L, R>;
+  detail::ParallelFor(nl, threads, [&](size_t begin, size_t end) {
+    if (begin >= end) return;
+    size_t next = detail::Partition(nr, [&](size_t j) { return s::Right(right[j]) > s::Left(left[begin]); });
+    for (size_t i = begin; i < end; ++i) {
+      const auto key = s::Left(left[i]);
+      next = detail::Gallop(next, nr, [&](size_t j) { return s::Right(right[j]) > key; });
+      match[i] = next > 0 ? next - 1 : nr;
+    }
+  });
+}
+
+/**
+ * @~english
+ * As-of join with a maximum lag: a right row only matches if it is at most tolerance before the left row.
+ * @param left The left column, sorted ascending.
+ * @param nl The number of left rows.
+ * @param right The right column, sorted ascending, in any ratio of the same units.
+ * @param nr The number of right rows.
+ * @param tolerance The maximum lag, in any ratio of the same units. Converted once.
+ * @param match Receives, for each left row, the index of the matching right row, or nr if there is none.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ */
+template <typename L, typename R, typename T>
+void AsOfJoin(const L* left, size_t nl, const R* right, size_t nr, const T& tolerance, size_t* match,
+              unsigned threads = 0) {
+  using s = detail::JoinScale<L, R>;
+  const auto tol = static_cast<typename s::common>(tolerance).GetValue();
+  AsOfJoin(left, nl, right, nr, match, threads);
+  detail::ParallelFor(nl, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (match[i] != nr && s::Left(left[i]) - s::Right(right[match[i]]) > tol) {
+        match[i] = nr;
+      }
+    }
+  });
+}
+
+/**
+ * @~english
+ * Tolerance-window join: for every left row, finds the right rows within tolerance of it in either direction.
+ * @param left The left column, sorted ascending.
+ * @param nl The number of left rows.
+ * @param right The right column, sorted ascending, in any ratio of the same units.
+ * @param nr The number of right rows.
+ * @param tolerance The half width of the window, in any ratio of the same units. Converted once.
+ * @param ranges Receives, for each left row, the range of matching right rows.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ */
+template <typename L, typename R, typename T>
+void WindowJoin(const L* left, size_t nl, const R* right, size_t nr, const T& tolerance, JoinRange* ranges,
+                unsigned threads = 0) {
+  using s = detail::JoinScale<L, R>;
+  const auto tol = static_cast<typename s::common>(tolerance).GetValue();
+  detail::ParallelFor(nl, threads, [&](size_t begin, size_t end) {
+    if (begin >= end) return;
+    const auto first = s::Left(left[begin]);
+    size_t lo = detail::Partition(nr, [&](size_t j) { return s::Right(right[j]) >= first - tol; });
+    size_t hi = detail::Partition(nr, [&](size_t j) { return s::Right(right[j]) > first + tol; });
+    for (size_t i = begin; i < end; ++i) {
+      const auto key = s::Left(left[i]);
+      lo = detail::Gallop(lo, nr, [&](size_t j) { return s::Right(right[j]) >= key - tol; });
+      hi = detail::Gallop(hi, nr, [&](size_t j) { return s::Right(right[j]) > key + tol; });
+      ranges[i] = {lo, hi};
+    }
+  });
+}
+
+}  // namespace units
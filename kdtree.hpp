@@ -0,0 +1,256 @@
+#pragma once
+/**
+ * @~english
+ * @file kdtree.hpp
+ * @brief Static k-d tree over length-typed coordinates.
+ *
+ * The tree is built once in bulk and stored implicitly: the node of the range [lo, hi) is its midpoint, so there are no
+ * child pointers. Coordinates are kept structure-of-arrays in tree order, and small ranges are scanned linearly.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <ratio>
+#include <type_traits>
+#include <vector>
+
+#include "parallel.hpp"
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Static k-d tree over points with Dims coordinates of unit L.
+ */
+template <typename L, size_t Dims>
+class KdTree {
+ public:
+  static_assert(Dims > 0, "At least one dimension required.");
+  static_assert(std::is_same<typename L::template units<1, 1>, Unit<typename L::value_type, 0, 1, 0, 0, 0, 0, 0>>::value,
+                "Coordinates must be lengths.");
+
+  /**
+   * @~english
+   * A point in the units of the tree.
+   */
+  using Point = std::array<L, Dims>;
+
+  /**
+   * @~english
+   * A distance in the ratio of L. Always double, so that distances between integral coordinates are not truncated.
+   */
+  using Distance = typename L::template rebind<double>;
+
+  /**
+   * @~english
+   * @brief A query result: the index of the point in the build input and its distance to the query.
+   */
+  struct Neighbor {
+    size_t index;
+    Distance distance;
+  };
+
+  /**
+   * @~english
+   * Builds the tree.
+   * @param points The points. Results refer to positions in this array.
+   * @param n The number of points.
+   */
+  KdTree(const Point* points, size_t n) : ids_(n), split_(n) {
+    std::iota(ids_.begin(), ids_.end(), size_t(0));
+    for (size_t d = 0; d < Dims; ++d) {
+      coords_[d].resize(n);
+    }
+    Build(points, 0, n);
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t d = 0; d < Dims; ++d) {
+        coords_[d][i] = static_cast<double>(points[ids_[i]][d].GetValue());
+      }
+    }
+  }
+
+  size_t Size() const noexcept { return ids_.size(); }
+
+  /**
+   * @~english
+   * Finds the nearest point.
+   * @param query The query point.
+   * @return The nearest neighbor. The index is Size() if the tree is empty.
+   */
+  Neighbor Nearest(const Point& query) const noexcept {
+    double q[Dims];
+    Load(query, q);
+    size_t best = Size();
+    double best_d2 = std::numeric_limits<double>::infinity();
+    Nearest(q, 0, Size(), &best, &best_d2);
+    return {best < Size() ? ids_[best] : Size(), Distance(std::sqrt(best_d2))};
+  }
+
+  /**
+   * @~english
+   * Finds all points within a radius, in no particular order.
+   * @param query The query point.
+   * @param radius The radius, in any ratio of L. Converted once per query.
+   * @param out The neighbors are appended to out.
+   */
+  template <typename R>
+  void Radius(const Point& query, const R& radius, std::vector<Neighbor>* out) const {
+    RadiusSquared(query, Squared(radius), out);
+  }
+
+  /**
+   * @~english
+   * Finds the nearest point for a batch of queries, split across threads.
+   * @param queries The query points.
+   * @param n The number of queries.
+   * @param out The nearest neighbor of each query.
+   * @param threads The number of threads. Zero uses the hardware concurrency.
+   */
+  void NearestBatch(const Point* queries, size_t n, Neighbor* out, unsigned threads = 0) const {
+    detail::ParallelFor(n, threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) out[i] = Nearest(queries[i]);
+    });
+  }
+
+  /**
+   * @~english
+   * Finds all points within a radius for a batch of queries, split across threads.
+   * @param queries The query points.
+   * @param n The number of queries.
+   * @param radius The radius, in any ratio of L.
+   * @param out The neighbors of each query. Resized to n.
+   * @param threads The number of threads. Zero uses the hardware concurrency.
+   */
+  template <typename R>
+  void RadiusBatch(const Point* queries, size_t n, const R& radius, std::vector<std::vector<Neighbor>>* out,
+                   unsigned threads = 0) const {
+    out->assign(n, {});
+    const double r2 = Squared(radius);
+    detail::ParallelFor(n, threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) RadiusSquared(queries[i], r2, &(*out)[i]);
+    });
+  }
+
+ private:
+  /**
+   * @~english
+   * Ranges at most this large are leaves and scanned linearly.
+   */
+  static constexpr size_t kLeafSize = 8;
+
+  /**
+   * @~english
+   * Converts a radius straight into the squared double coordinates of the tree, without passing through L, whose
+   * value type may be integral.
+   */
+  template <typename R>
+  static double Squared(const R& radius) noexcept {
+    static_assert(std::is_same<typename R::template units<1, 1>,
+                               typename L::template units<1, 1>::template rebind<typename R::value_type>>::value,
+                  "The radius must be a length.");
+    using s = std::ratio_divide<typename R::scale, typename L::scale>;
+    const double r = static_cast<double>(radius.GetValue()) * (double(s::num) / double(s::den));
+    return r * r;
+  }
+
+  void RadiusSquared(const Point& query, double r2, std::vector<Neighbor>* out) const {
+    double q[Dims];
+    Load(query, q);
+    Radius(q, r2, 0, Size(), out);
+  }
+
+  void Build(const Point* points, size_t lo, size_t hi) {
+    if (hi - lo <= kLeafSize) return;
+    uint8_t dim = 0;
+    double spread = -1.0;
+    for (size_t d = 0; d < Dims; ++d) {
+      double min = std::numeric_limits<double>::infinity();
+      double max = -min;
+      for (size_t i = lo; i < hi; ++i) {
+        const double c = static_cast<double>(points[ids_[i]][d].GetValue());
+        min = std::min(min, c);
+        max = std::max(max, c);
+      }
+      if (max - min > spread) {
+        spread = max - min;
+        dim = static_cast<uint8_t>(d);
+      }
+    }
+    const size_t mid = lo + (hi - lo) / 2;
+    std::nth_element(ids_.begin() + lo, ids_.begin() + mid, ids_.begin() + hi, [&](size_t a, size_t b) {
+      return points[a][dim].GetValue() < points[b][dim].GetValue();
+    });
+    split_[mid] = dim;
+    Build(points, lo, mid);
+    Build(points, mid + 1, hi);
+  }
+
+  static void Load(const Point& p, double* q) noexcept {
+    for (size_t d = 0; d < Dims; ++d) q[d] = static_cast<double>(p[d].GetValue());
+  }
+
+  double Distance2(const double* q, size_t i) const noexcept {
+    double d2 = 0.0;
+    for (size_t d = 0; d < Dims; ++d) {
+      const double diff = coords_[d][i] - q[d];
+      d2 += diff * diff;
+    }
+    return d2;
+  }
+
+  void Nearest(const double* q, size_t lo, size_t hi, size_t* best, double* best_d2) const noexcept {
+    if (hi - lo <= kLeafSize) {
+      for (size_t i = lo; i < hi; ++i) {
+        const double d2 = Distance2(q, i);
+        if (d2 < *best_d2) {
+          *best_d2 = d2;
+          *best = i;
+        }
+      }
+      return;
+    }
+    const size_t mid = lo + (hi - lo) / 2;
+    const double d2 = Distance2(q, mid);
+    if (d2 < *best_d2) {
+      *best_d2 = d2;
+      *best = mid;
+    }
+    const double diff = q[split_[mid]] - coords_[split_[mid]][mid];
+    if (diff < 0.0) {
+      Nearest(q, lo, mid, best, best_d2);
+      if (diff * diff < *best_d2) Nearest(q, mid + 1, hi, best, best_d2);
+    } else {
+      Nearest(q, mid + 1, hi, best, best_d2);
+      if (diff * diff < *best_d2) Nearest(q, lo, mid, best, best_d2);
+    }
+  }
+
+  void Radius(const double* q, double r2, size_t lo, size_t hi, std::vector<Neighbor>* out) const {
+    if (hi - lo <= kLeafSize) {
+      for (size_t i = lo; i < hi; ++i) Collect(q, r2, i, out);
+      return;
+    }
+    const size_t mid = lo + (hi - lo) / 2;
+    Collect(q, r2, mid, out);
+    const double diff = q[split_[mid]] - coords_[split_[mid]][mid];
+    if (diff <= 0.0 || diff * diff <= r2) Radius(q, r2, lo, mid, out);
+    if (diff >= 0.0 || diff * diff <= r2) Radius(q, r2, mid + 1, hi, out);
+  }
+
+  void Collect(const double* q, double r2, size_t i, std::vector<Neighbor>* out) const {
+    const double d2 = Distance2(q, i);
+    if (d2 <= r2) out->push_back({ids_[i], Distance(std::sqrt(d2))});
+  }
+
+  std::array<std::vector<double>, Dims> coords_;
+  std::vector<size_t> ids_;
+  std::vector<uint8_t> split_;
+};
+
+}  // namespace units
@@ -0,0 +1,301 @@
+#pragma once
+/**
+ * @~english
+ * @file measurement.hpp
+ * @brief Value type carrying a standard deviation, usable as the value type of a Unit.
+ *
+ * Arithmetic propagates uncertainty with first order (linear) error propagation, assuming the operands are
+ * uncorrelated. The Sum/Difference/Product/Quotient functions take an explicit correlation coefficient when the
+ * operands are known to be correlated. Invalid arguments, such as a correlation outside [-1, 1] or arrays of different
+ * sizes, throw std::invalid_argument.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief A value with a standard deviation.
+ */
+template <typename T>
+class Measurement {
+ public:
+  static_assert(std::is_floating_point<T>::value, "Only floating point measurements supported.");
+
+  /**
+   * @~english
+   * The floating point type of the value and sigma.
+   */
+  using value_type = T;
+
+  Measurement() = default;
+
+  /**
+   * @~english
+   * Value constructor
+   * @param value The central value.
+   * @param sigma The standard deviation.
+   */
+  constexpr Measurement(T value, T sigma = T(0)) : value_(value), sigma_(sigma) {}
+
+  /**
+   * @~english
+   * Gets the central value.
+   * @return The central value.
+   */
+  constexpr T GetValue() const noexcept { return value_; }
+
+  /**
+   * @~english
+   * Gets the standard deviation.
+   * @return The standard deviation.
+   */
+  constexpr T GetSigma() const noexcept { return sigma_; }
+
+  constexpr Measurement operator-() const noexcept { return {-value_, sigma_}; }
+
+  Measurement& operator+=(const Measurement& other) noexcept { return *this = *this + other; }
+  Measurement& operator-=(const Measurement& other) noexcept { return *this = *this - other; }
+  Measurement& operator*=(const Measurement& other) noexcept { return *this = *this * other; }
+  Measurement& operator/=(const Measurement& other) noexcept { return *this = *this / other; }
+
+  friend Measurement operator+(const Measurement& a, const Measurement& b) noexcept {
+    return {a.value_ + b.value_, std::hypot(a.sigma_, b.sigma_)};
+  }
+
+  friend Measurement operator-(const Measurement& a, const Measurement& b) noexcept {
+    return {a.value_ - b.value_, std::hypot(a.sigma_, b.sigma_)};
+  }
+
+  friend Measurement operator*(const Measurement& a, const Measurement& b) noexcept {
+    return {a.value_ * b.value_, std::hypot(b.value_ * a.sigma_, a.value_ * b.sigma_)};
+  }
+
+  friend Measurement operator/(const Measurement& a, const Measurement& b) noexcept {
+    const T q = a.value_ / b.value_;
+    return {q, std::hypot(a.sigma_ / b.value_, q * b.sigma_ / b.value_)};
+  }
+
+  /**
+   * @~english
+   * Comparisons only consider the central value.
+   */
+  friend constexpr bool operator==(const Measurement& a, const Measurement& b) noexcept { return a.value_ == b.value_; }
+  friend constexpr bool operator!=(const Measurement& a, const Measurement& b) noexcept { return a.value_ != b.value_; }
+  friend constexpr bool operator<(const Measurement& a, const Measurement& b) noexcept { return a.value_ < b.value_; }
+  friend constexpr bool operator>(const Measurement& a, const Measurement& b) noexcept { return a.value_ > b.value_; }
+  friend constexpr bool operator<=(const Measurement& a, const Measurement& b) noexcept { return a.value_ <= b.value_; }
+  friend constexpr bool operator>=(const Measurement& a, const Measurement& b) noexcept { return a.value_ >= b.value_; }
+
+ private:
+  T value_;
+  T sigma_;
+};
+
+/**
+ * @~english
+ * Exact scalar operations. These are what Unit uses when rescaling between ratios.
+ */
+template <typename T, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+constexpr Measurement<T> operator*(const Measurement<T>& m, S c) noexcept {
+  return {m.GetValue() * c, m.GetSigma() * (c < S(0) ? -T(c) : T(c))};
+}
+
+template <typename T, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+constexpr Measurement<T> operator*(S c, const Measurement<T>& m) noexcept {
+  return m * c;
+}
+
+template <typename T, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+constexpr Measurement<T> operator/(const Measurement<T>& m, S c) noexcept {
+  return {m.GetValue() / c, m.GetSigma() / (c < S(0) ? -T(c) : T(c))};
+}
+
+template <typename T>
+struct is_value_type<Measurement<T>> : std::true_type {};
+
+namespace detail {
+
+/**
+ * @~english
+ * Standard deviation of a correlated combination, given the variance before clamping. Rounding can leave a variance
+ * slightly below zero when |rho| is 1; a correlation outside [-1, 1] is rejected instead of hidden.
+ */
+template <typename T>
+T CorrelatedSigma(T variance, T rho) {
+  if (!(rho >= T(-1) && rho <= T(1))) throw std::invalid_argument("correlation outside [-1, 1]");
+  return std::sqrt(std::max(T(0), variance));
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * Sum of two correlated measurements.
+ * @param rho The correlation coefficient between a and b, in [-1, 1].
+ */
+template <typename T>
+Measurement<T> Sum(const Measurement<T>& a, const Measurement<T>& b, T rho) {
+  const T sa = a.GetSigma(), sb = b.GetSigma();
+  return {a.GetValue() + b.GetValue(), detail::CorrelatedSigma(sa * sa + sb * sb + 2 * rho * sa * sb, rho)};
+}
+
+/**
+ * @~english
+ * Difference of two correlated measurements.
+ * @param rho The correlation coefficient between a and b, in [-1, 1].
+ */
+template <typename T>
+Measurement<T> Difference(const Measurement<T>& a, const Measurement<T>& b, T rho) {
+  const T sa = a.GetSigma(), sb = b.GetSigma();
+  return {a.GetValue() - b.GetValue(), detail::CorrelatedSigma(sa * sa + sb * sb - 2 * rho * sa * sb, rho)};
+}
+
+/**
+ * @~english
+ * Product of two correlated measurements.
+ * @param rho The correlation coefficient between a and b, in [-1, 1].
+ */
+template <typename T>
+Measurement<T> Product(const Measurement<T>& a, const Measurement<T>& b, T rho) {
+  const T da = b.GetValue() * a.GetSigma(), db = a.GetValue() * b.GetSigma();
+  return {a.GetValue() * b.GetValue(), detail::CorrelatedSigma(da * da + db * db + 2 * rho * da * db, rho)};
+}
+
+/**
+ * @~english
+ * Quotient of two correlated measurements.
+ * @param rho The correlation coefficient between a and b, in [-1, 1].
+ */
+template <typename T>
+Measurement<T> Quotient(const Measurement<T>& a, const Measurement<T>& b, T rho) {
+  const T q = a.GetValue() / b.GetValue();
+  const T da = a.GetSigma() / b.GetValue(), db = q * b.GetSigma() / b.GetValue();
+  return {q, detail::CorrelatedSigma(da * da + db * db - 2 * rho * da * db, rho)};
+}
+
+/**
+ * @~english
+ * @brief Structure-of-arrays storage for units with a Measurement value type. Values and sigmas are kept in separate
+ * contiguous lanes so bulk propagation vectorizes.
+ */
+template <typename U>
+class MeasurementArray {
+ public:
+  /**
+   * @~english
+   * The floating point type of each lane.
+   */
+  using scalar_type = typename U::value_type::value_type;
+
+  /**
+   * @~english
+   * Constructor
+   * @param size The number of elements, all initialized to zero.
+   */
+  explicit MeasurementArray(size_t size = 0) : values_(size), sigmas_(size) {}
+
+  size_t Size() const noexcept { return values_.size(); }
+
+  U Get(size_t i) const noexcept { return U({values_[i], sigmas_[i]}); }
+
+  void Set(size_t i, const U& u) noexcept {
+    values_[i] = u.GetValue().GetValue();
+    sigmas_[i] = u.GetValue().GetSigma();
+  }
+
+  scalar_type* Values() noexcept { return values_.data(); }
+  const scalar_type* Values() const noexcept { return values_.data(); }
+  scalar_type* Sigmas() noexcept { return sigmas_.data(); }
+  const scalar_type* Sigmas() const noexcept { return sigmas_.data(); }
+
+ private:
+  std::vector<scalar_type> values_;
+  std::vector<scalar_type> sigmas_;
+};
+
+namespace detail {
+
+template <typename U1, typename U2>
+void CheckSameSize(const MeasurementArray<U1>& a, const MeasurementArray<U2>& b) {
+  if (a.Size() != b.Size()) throw std::invalid_argument("measurement arrays differ in size");
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * Element-wise sum of two uncorrelated arrays. Operands in different ratios are rescaled to the ratio chosen by
+ * Unit::operator+ with a single folded factor each.
+ * @return Array of the summed units.
+ * @throws std::invalid_argument If the arrays differ in size.
+ */
+template <typename U1, typename U2, typename R = decltype(std::declval<U1>() + std::declval<U2>())>
+MeasurementArray<R> Add(const MeasurementArray<U1>& a, const MeasurementArray<U2>& b) {
+  detail::CheckSameSize(a, b);
+  using T = typename MeasurementArray<R>::scalar_type;
+  using fa = std::ratio_divide<typename U1::scale, typename R::scale>;
+  using fb = std::ratio_divide<typename U2::scale, typename R::scale>;
+  const T ka = T(fa::num) / T(fa::den), kb = T(fb::num) / T(fb::den);
+  MeasurementArray<R> out(a.Size());
+  const T *av = a.Values(), *as = a.Sigmas(), *bv = b.Values(), *bs = b.Sigmas();
+  T *ov = out.Values(), *os = out.Sigmas();
+  for (size_t i = 0; i < out.Size(); ++i) {
+    ov[i] = av[i] * ka + bv[i] * kb;
+    os[i] = std::sqrt(as[i] * as[i] * (ka * ka) + bs[i] * bs[i] * (kb * kb));
+  }
+  return out;
+}
+
+/**
+ * @~english
+ * Element-wise product of two uncorrelated arrays.
+ * @return Array of the multiplied units.
+ * @throws std::invalid_argument If the arrays differ in size.
+ */
+template <typename U1, typename U2, typename R = decltype(std::declval<U1>() * std::declval<U2>())>
+MeasurementArray<R> Multiply(const MeasurementArray<U1>& a, const MeasurementArray<U2>& b) {
+  detail::CheckSameSize(a, b);
+  using T = typename MeasurementArray<R>::scalar_type;
+  MeasurementArray<R> out(a.Size());
+  const T *av = a.Values(), *as = a.Sigmas(), *bv = b.Values(), *bs = b.Sigmas();
+  T *ov = out.Values(), *os = out.Sigmas();
+  for (size_t i = 0; i < out.Size(); ++i) {
+    const T da = bv[i] * as[i], db = av[i] * bs[i];
+    ov[i] = av[i] * bv[i];
+    os[i] = std::sqrt(da * da + db * db);
+  }
+  return out;
+}
+
+/**
+ * @~english
+ * Element-wise quotient of two uncorrelated arrays.
+ * @return Array of the divided units.
+ * @throws std::invalid_argument If the arrays differ in size.
+ */
+template <typename U1, typename U2, typename R = decltype(std::declval<U1>() / std::declval<U2>())>
+MeasurementArray<R> Divide(const MeasurementArray<U1>& a, const MeasurementArray<U2>& b) {
+  detail::CheckSameSize(a, b);
+  using T = typename MeasurementArray<R>::scalar_type;
+  MeasurementArray<R> out(a.Size());
+  const T *av = a.Values(), *as = a.Sigmas(), *bv = b.Values(), *bs = b.Sigmas();
+  T *ov = out.Values(), *os = out.Sigmas();
+  for (size_t i = 0; i < out.Size(); ++i) {
+    const T q = av[i] / bv[i];
+    const T da = as[i] / bv[i], db = q * bs[i] / bv[i];
+    ov[i] = q;
+    os[i] = std::sqrt(da * da + db * db);
+  }
+  return out;
+}
+
+}  // namespace units
@@ -0,0 +1,71 @@
+#pragma once
+/**
+ * @~english
+ * @file nonsi.hpp
+ * @brief Common non-SI units expressed through exact compile-time ratios.
+ *
+ * Every conversion between these units and SI units, e.g. feet per minute to meters per second, folds into a single
+ * compile-time factor, which is also what the bulk Convert() uses.
+ */
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * Rational value of pi, 245850922 / 78256779. This convergent of the continued fraction of pi is within 2.5e-17
+ * relative error, below half an ulp of a double, so it is exact for double precision conversions. Products of more
+ * than one angle in these units may exceed 64-bit ratios, which is diagnosed at compile time.
+ */
+using pi = std::ratio<245850922, 78256779>;
+
+/**
+ * @~english
+ * Defines common non-SI units with the given arithmetic type.
+ * @param type The arithmetic type used to store the value of the unit.
+ */
+#define DEFINE_NONSI(type) \
+using Inch = Unit<type, 0, 1, 0, 0, 0, 0, 0, 127, 5000>;                          \
+using Foot = Unit<type, 0, 1, 0, 0, 0, 0, 0, 381, 1250>;                          \
+using Yard = Unit<type, 0, 1, 0, 0, 0, 0, 0, 1143, 1250>;                         \
+using Mile = Unit<type, 0, 1, 0, 0, 0, 0, 0, 201168, 125>;                        \
+using NauticalMile = Unit<type, 0, 1, 0, 0, 0, 0, 0, 1852, 1>;                    \
+using Minute = Unit<type, 1, 0, 0, 0, 0, 0, 0, 60, 1>;                            \
+using Hour = Unit<type, 1, 0, 0, 0, 0, 0, 0, 3600, 1>;                            \
+using Day = Unit<type, 1, 0, 0, 0, 0, 0, 0, 86400, 1>;                            \
+using Degree = Unit<type, 0, 0, 0, 0, 1, 0, 0, 122925461, 7043110110>;            \
+using Arcminute = Unit<type, 0, 0, 0, 0, 1, 0, 0, 122925461, 422586606600>;       \
+using Arcsecond = Unit<type, 0, 0, 0, 0, 1, 0, 0, 122925461, 25355196396000>;     \
+using Revolution = Unit<type, 0, 0, 0, 0, 1, 0, 0, 491701844, 78256779>;          \
+using Pound = Unit<type, 0, 0, 0, 0, 0, 0, 1, 45359237, 100000>;                  \
+using Ounce = Unit<type, 0, 0, 0, 0, 0, 0, 1, 45359237, 1600000>;                 \
+using Rankine = Unit<type, 0, 0, 0, 1, 0, 0, 0, 5, 9>;                            \
+using Knot = Unit<type, -1, 1, 0, 0, 0, 0, 0, 463, 900>;                          \
+using MilePerHour = Unit<type, -1, 1, 0, 0, 0, 0, 0, 1397, 3125>;                 \
+using Pascal = Unit<type, -2, -1, 0, 0, 0, 0, 1, 1000, 1>;                        \
+using Psi = Unit<type, -2, -1, 0, 0, 0, 0, 1, 8896443230521, 1290320>;            \
+using Bar = Unit<type, -2, -1, 0, 0, 0, 0, 1, 100000000, 1>;                      \
+using Atmosphere = Unit<type, -2, -1, 0, 0, 0, 0, 1, 101325000, 1>;
+
+namespace i {
+
+/**
+ * @~english
+ * All int64-based non-SI units
+ */
+DEFINE_NONSI(int64_t)
+
+}  // namespace i
+
+namespace d {
+
+/**
+ * @~english
+ * All double-based non-SI units
+ */
+DEFINE_NONSI(double)
+
+}  // namespace d
+
+}  // namespace units
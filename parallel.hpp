@@ -0,0 +1,93 @@
+#pragma once
+/**
+ * @~english
+ * @file parallel.hpp
+ * @brief Minimal fork-join helper shared by the bulk algorithms.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace units {
+namespace detail {
+
+/**
+ * @~english
+ * Resolves a requested thread count, where zero means the hardware concurrency.
+ * @param threads The requested number of threads.
+ * @return The number of threads to use, at least one.
+ */
+inline unsigned ThreadCount(unsigned threads) noexcept {
+  return threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * @~english
+ * @brief Worker threads joined on destruction, so that a failure to start a thread, or an exception on the calling
+ * thread, waits for the threads already running instead of calling std::terminate.
+ */
+class Workers {
+ public:
+  Workers() = default;
+  Workers(const Workers&) = delete;
+  Workers& operator=(const Workers&) = delete;
+  ~Workers() { Join(); }
+
+  template <typename... Args>
+  void Start(Args&&... args) {
+    threads_.emplace_back(std::forward<Args>(args)...);
+  }
+
+  void Join() {
+    for (auto& t : threads_) {
+      if (t.joinable()) t.join();
+    }
+  }
+
+ private:
+  std::vector<std::thread> threads_;
+};
+
+/**
+ * @~english
+ * Splits [0, n) into contiguous chunks, one per thread, and calls f(begin, end) for each. The calling thread runs the
+ * first chunk.
+ * @param n The size of the range.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ * @param f The function called for each chunk.
+ */
+template <typename F>
+void ParallelFor(size_t n, unsigned threads, F f) {
+  const size_t count = ThreadCount(threads);
+  const size_t chunk = (n + count - 1) / count;
+  Workers workers;
+  for (size_t begin = chunk; begin < n; begin += chunk) {
+    workers.Start(f, begin, std::min(n, begin + chunk));
+  }
+  f(size_t(0), std::min(n, chunk));
+  workers.Join();
+}
+
+/**
+ * @~english
+ * Runs f(task) for every task in [0, tasks), each on its own thread. The calling thread runs task zero.
+ * @param tasks The number of tasks.
+ * @param f The function called for each task.
+ */
+template <typename F>
+void ParallelTasks(unsigned tasks, F f) {
+  Workers workers;
+  for (unsigned t = 1; t < tasks; ++t) {
+    workers.Start(f, t);
+  }
+  if (tasks > 0) {
+    f(0u);
+  }
+  workers.Join();
+}
+
+}  // namespace detail
+}  // namespace units
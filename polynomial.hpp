@@ -0,0 +1,206 @@
+#pragma once
+/**
+ * @~english
+ * @file polynomial.hpp
+ * @brief Polynomials whose coefficient units are derived from their input and output units.
+ *
+ * The coefficient of x^k has the units Out / In^k, so a calibration curve from volts to kelvins takes a kelvin, a
+ * kelvin per volt, a kelvin per square volt and so on. Every coefficient is converted into the ratio Out / In^k once
+ * at construction; the terms then sum directly in the ratio of Out with no rescaling during evaluation. Terms are
+ * stored recursively so that scalar evaluation is constexpr. Batch evaluation copies the coefficients into a flat
+ * array and runs Horner's or Estrin's scheme with fixed trip counts, leaving the loop over elements to vectorize.
+ */
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Evaluation schemes for polynomial batches.
+ */
+enum class PolynomialScheme {
+  /** Nested multiply-adds. Fewest operations, one long dependency chain per element. */
+  kHorner,
+  /** Pairwise combination with squared powers of x. More operations, dependency chain of log2(degree) steps. */
+  kEstrin,
+};
+
+namespace detail {
+
+template <typename Out, typename In>
+using UnitQuotient = decltype(std::declval<Out>() / std::declval<In>());
+
+/**
+ * @~english
+ * Units of the coefficient of x^K.
+ */
+template <typename In, typename Out, size_t K>
+struct PolynomialCoefficient {
+  using type = typename PolynomialCoefficient<In, UnitQuotient<Out, In>, K - 1>::type;
+};
+
+template <typename In, typename Out>
+struct PolynomialCoefficient<In, Out, 0> {
+  using type = Out;
+};
+
+/**
+ * @~english
+ * Coefficients of x^0 (head) through x^Degree, each in the ratio its power requires.
+ */
+template <typename In, typename Out, size_t Degree>
+struct PolynomialTerms {
+  using V = typename Out::value_type;
+
+  template <typename C0, typename... Rest>
+  constexpr PolynomialTerms(const C0& c0, const Rest&... rest)
+      : head(static_cast<Out>(c0).GetValue()), tail(rest...) {
+    static_assert(std::is_same<typename C0::template units<1, 1>, typename Out::template units<1, 1>>::value,
+                  "Coefficient has the wrong units for its power.");
+  }
+
+  constexpr V Horner(V x) const noexcept { return head + x * tail.Horner(x); }
+  constexpr V Get(size_t k) const noexcept { return k == 0 ? head : tail.Get(k - 1); }
+
+  V head;
+  PolynomialTerms<In, UnitQuotient<Out, In>, Degree - 1> tail;
+};
+
+template <typename In, typename Out>
+struct PolynomialTerms<In, Out, 0> {
+  using V = typename Out::value_type;
+
+  template <typename C0>
+  constexpr PolynomialTerms(const C0& c0) : head(static_cast<Out>(c0).GetValue()) {
+    static_assert(std::is_same<typename C0::template units<1, 1>, typename Out::template units<1, 1>>::value,
+                  "Coefficient has the wrong units for its power.");
+  }
+
+  constexpr V Horner(V) const noexcept { return head; }
+  constexpr V Get(size_t) const noexcept { return head; }
+
+  V head;
+};
+
+/**
+ * @~english
+ * Evaluates c[0] + c[1] x + ... + c[N - 1] x^(N - 1) with Estrin's scheme.
+ */
+template <typename V, size_t N>
+V Estrin(const std::array<V, N>& c, V x) noexcept {
+  std::array<V, N> t = c;
+  size_t terms = N;
+  V power = x;
+  while (terms > 1) {
+    for (size_t i = 0; i < terms / 2; ++i) {
+      t[i] = t[2 * i] + t[2 * i + 1] * power;
+    }
+    if (terms % 2 != 0) {
+      t[terms / 2] = t[terms - 1];
+    }
+    terms = (terms + 1) / 2;
+    power *= power;
+  }
+  return t[0];
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * @brief Polynomial of the given degree mapping In to Out.
+ */
+template <typename In, typename Out, size_t Degree>
+class Polynomial {
+ public:
+  static_assert(std::is_same<typename In::value_type, typename Out::value_type>::value,
+                "Input and output must share a value type.");
+
+  using value_type = typename Out::value_type;
+
+  /**
+   * @~english
+   * Units of the coefficient of x^K, i.e. Out / In^K.
+   */
+  template <size_t K>
+  using coefficient = typename detail::PolynomialCoefficient<In, Out, K>::type;
+
+  /**
+   * @~english
+   * Constructor
+   * @param coefficients The Degree + 1 coefficients of x^0 through x^Degree, each in any ratio of Out / In^k.
+   */
+  template <typename... C>
+  constexpr explicit Polynomial(const C&... coefficients) : terms_(coefficients...) {
+    static_assert(sizeof...(C) == Degree + 1, "A polynomial of degree d takes d + 1 coefficients.");
+  }
+
+  static constexpr size_t GetDegree() noexcept { return Degree; }
+
+  /**
+   * @~english
+   * Gets a coefficient.
+   * @return The coefficient of x^K.
+   */
+  template <size_t K>
+  constexpr coefficient<K> Get() const noexcept {
+    static_assert(K <= Degree, "Coefficient index exceeds the degree.");
+    return coefficient<K>(terms_.Get(K));
+  }
+
+  /**
+   * @~english
+   * Evaluates the polynomial with Horner's scheme.
+   * @param x The input, in any ratio of In.
+   * @return The output.
+   */
+  template <typename X>
+  constexpr Out operator()(const X& x) const noexcept {
+    return Out(terms_.Horner(static_cast<In>(x).GetValue()));
+  }
+
+  /**
+   * @~english
+   * Evaluates the polynomial over an array.
+   * @param in The inputs, in any ratio of In. The rescale factor is folded into each element's load.
+   * @param out The outputs. May alias in if X is Out.
+   * @param n The number of elements.
+   * @param scheme The evaluation scheme. Horner is usually fastest when the batch is large enough to keep the
+   * multiply-add units busy; Estrin shortens the dependency chain for high degrees.
+   */
+  template <typename X>
+  void Evaluate(const X* in, Out* out, size_t n, PolynomialScheme scheme = PolynomialScheme::kHorner) const noexcept {
+    static_assert(std::is_same<typename X::template units<1, 1>, typename In::template units<1, 1>>::value,
+                  "Input has the wrong units.");
+    using s = std::ratio_divide<typename X::scale, typename In::scale>;
+    std::array<value_type, Degree + 1> c;
+    for (size_t k = 0; k <= Degree; ++k) {
+      c[k] = terms_.Get(k);
+    }
+    if (scheme == PolynomialScheme::kEstrin) {
+      for (size_t i = 0; i < n; ++i) {
+        out[i] = Out(detail::Estrin(c, detail::Rescale<s>(in[i].GetValue())));
+      }
+      return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      const value_type x = detail::Rescale<s>(in[i].GetValue());
+      value_type y = c[Degree];
+      for (size_t k = Degree; k-- > 0;) {
+        y = y * x + c[k];
+      }
+      out[i] = Out(y);
+    }
+  }
+
+ private:
+  detail::PolynomialTerms<In, Out, Degree> terms_;
+};
+
+}  // namespace units
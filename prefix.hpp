@@ -0,0 +1,233 @@
+#pragma once
+/**
+ * @~english
+ * @file prefix.hpp
+ * @brief Runtime conversion between the SI prefixes of DEFINE_PREFIXES, through tables generated at compile time.
+ *
+ * Prefixes are identified by their index, see GetPrefix(), ordered from atto to exa with the unprefixed unit in the
+ * middle. The factor between every pair of prefixes is built once at compile time, both as a double and as an exact
+ * integer multiply-or-divide with its overflow bound, so a runtime conversion is a table load and one multiply (or one
+ * divide, for integers moving to a larger prefix) instead of a std::pow call.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief An SI prefix, e.g. milli: symbol "m", exponent -3, ratio 1/1000. Micro is "u".
+ */
+struct SiPrefix {
+  const char* symbol;
+  const char* name;
+  int32_t exponent;
+  intmax_t num;
+  intmax_t den;
+};
+
+/**
+ * @~english
+ * Number of prefixes, counting the unprefixed unit.
+ */
+constexpr size_t kPrefixCount = 17;
+
+/**
+ * @~english
+ * Index of the unprefixed unit.
+ */
+constexpr size_t kUnprefixed = 8;
+
+/**
+ * @~english
+ * Index returned for ratios that are not an SI prefix.
+ */
+constexpr size_t kNoPrefix = kPrefixCount;
+
+namespace detail {
+
+constexpr SiPrefix kSiPrefixes[kPrefixCount] = {
+    {"a", "atto", -18, 1, 1000000000000000000}, {"f", "femto", -15, 1, 1000000000000000},
+    {"p", "pico", -12, 1, 1000000000000},       {"n", "nano", -9, 1, 1000000000},
+    {"u", "micro", -6, 1, 1000000},             {"m", "milli", -3, 1, 1000},
+    {"c", "centi", -2, 1, 100},                 {"d", "deci", -1, 1, 10},
+    {"", "", 0, 1, 1},                          {"da", "deca", 1, 10, 1},
+    {"h", "hecto", 2, 100, 1},                  {"k", "kilo", 3, 1000, 1},
+    {"M", "mega", 6, 1000000, 1},               {"G", "giga", 9, 1000000000, 1},
+    {"T", "tera", 12, 1000000000000, 1},        {"P", "peta", 15, 1000000000000000, 1},
+    {"E", "exa", 18, 1000000000000000000, 1}};
+
+/**
+ * @~english
+ * The conversion from one prefix to another. Integers are multiplied by multiplier when it is non-zero, and otherwise
+ * divided by divisor, where a zero divisor truncates every value to 0. A multiply overflows when the magnitude of the
+ * value exceeds limit.
+ */
+struct PrefixConversion {
+  double factor;
+  int64_t multiplier;
+  int64_t divisor;
+  int64_t limit;
+};
+
+constexpr long double PowerOfTen(int32_t e) {
+  return e < 0 ? 1 / PowerOfTen(-e) : e == 0 ? 1 : 10 * PowerOfTen(e - 1);
+}
+
+constexpr int64_t IntegerPowerOfTen(int32_t digits) { return digits <= 0 ? 1 : 10 * IntegerPowerOfTen(digits - 1); }
+
+// 10^19 exceeds int64_t: larger multiplies overflow for any non-zero value, and larger divides truncate to 0.
+constexpr PrefixConversion MakeConversion(int32_t e, int32_t digits, int64_t p) {
+  return {double(PowerOfTen(e)), e >= 0 ? p : 0, e >= 0 ? 1 : digits > 18 ? 0 : p,
+          digits > 18 ? 0 : std::numeric_limits<int64_t>::max() / p};
+}
+
+constexpr PrefixConversion MakeConversion(int32_t e) {
+  return MakeConversion(e, e < 0 ? -e : e, IntegerPowerOfTen(e < -18 || e > 18 ? 18 : e < 0 ? -e : e));
+}
+
+/**
+ * @~english
+ * The conversions between every pair of prefixes, entry from * kPrefixCount + to holding the one from prefix from to
+ * prefix to.
+ */
+struct PrefixTable {
+  PrefixConversion entries[kPrefixCount * kPrefixCount];
+
+  constexpr const PrefixConversion& At(size_t from, size_t to) const noexcept {
+    return entries[from * kPrefixCount + to];
+  }
+};
+
+template <size_t... I>
+constexpr PrefixTable MakePrefixTable(IndexList<I...>) {
+  return PrefixTable{
+      {MakeConversion(kSiPrefixes[I / kPrefixCount].exponent - kSiPrefixes[I % kPrefixCount].exponent)...}};
+}
+
+template <typename = void>
+struct PrefixTables {
+  static constexpr PrefixTable value = MakePrefixTable(typename MakeIndexList<kPrefixCount * kPrefixCount>::type());
+};
+
+template <typename T>
+constexpr PrefixTable PrefixTables<T>::value;
+
+constexpr size_t FindPrefix(intmax_t num, intmax_t den, size_t i = 0) noexcept {
+  return i == kPrefixCount ? kNoPrefix
+                           : kSiPrefixes[i].num == num && kSiPrefixes[i].den == den ? i : FindPrefix(num, den, i + 1);
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * Gets a prefix by index.
+ * @param index The index, below kPrefixCount.
+ */
+constexpr const SiPrefix& GetPrefix(size_t index) noexcept { return detail::kSiPrefixes[index]; }
+
+/**
+ * @~english
+ * Gets the prefix index of a unit's ratio, e.g. 5 (milli) for i::Millimeter, or kNoPrefix if the ratio is not a prefix.
+ */
+template <typename U>
+constexpr size_t PrefixIndexOf() noexcept {
+  return detail::FindPrefix(U::scale::num, U::scale::den);
+}
+
+/**
+ * @~english
+ * Gets the exact factor from one prefix to another as a double, e.g. 1000 from kilo to the unprefixed unit.
+ */
+constexpr double PrefixFactor(size_t from, size_t to) noexcept {
+  return detail::PrefixTables<>::value.At(from, to).factor;
+}
+
+/**
+ * @~english
+ * Converts a floating point value between prefixes with one multiply.
+ * @param value The value, in prefix from.
+ * @param from The prefix index of value.
+ * @param to The prefix index of the result.
+ * @return The value in prefix to.
+ */
+template <typename T>
+constexpr T ConvertPrefix(T value, size_t from, size_t to) noexcept {
+  static_assert(std::is_floating_point<T>::value, "Integers convert through the overload reporting overflow.");
+  return value * T(detail::PrefixTables<>::value.At(from, to).factor);
+}
+
+/**
+ * @~english
+ * Converts an integer value between prefixes with one multiply or one truncating divide.
+ * @param value The value, in prefix from.
+ * @param from The prefix index of value.
+ * @param to The prefix index of the result.
+ * @param out Receives the value in prefix to.
+ * @return False if the result does not fit in int64_t, in which case out is unchanged.
+ */
+inline bool ConvertPrefix(int64_t value, size_t from, size_t to, int64_t* out) noexcept {
+  const detail::PrefixConversion& c = detail::PrefixTables<>::value.At(from, to);
+  if (c.multiplier == 0) {
+    *out = c.divisor == 0 ? 0 : value / c.divisor;
+    return true;
+  }
+  if (value > c.limit || value < -c.limit) return false;
+  *out = value * c.multiplier;
+  return true;
+}
+
+/**
+ * @~english
+ * Picks the prefix that brings a value into [1, 1000), or into [1, 10) among the non-engineering prefixes too.
+ * Values beyond the range of the prefixes get the smallest or largest prefix. Zero and non-finite values keep from.
+ * @param value The value, in prefix from.
+ * @param from The prefix index of value.
+ * @param engineering Whether to consider only prefixes whose exponent is a multiple of 3.
+ * @return The prefix index.
+ */
+inline size_t SelectPrefix(double value, size_t from, bool engineering = true) noexcept {
+  const double magnitude = std::abs(value) * PrefixFactor(from, kUnprefixed);
+  if (!(magnitude > 0) || !std::isfinite(magnitude)) return from;
+  size_t best = 0;
+  for (size_t i = kPrefixCount; i-- > 0;) {
+    if (engineering && GetPrefix(i).exponent % 3 != 0) continue;
+    best = i;
+    if (magnitude >= PrefixFactor(i, kUnprefixed)) break;
+  }
+  return best;
+}
+
+/**
+ * @~english
+ * @brief A value together with the index of its prefix, e.g. for display as "420 us".
+ */
+struct PrefixedValue {
+  double value;
+  size_t prefix;
+};
+
+/**
+ * @~english
+ * Rescales a unit to the prefix that reads best, see SelectPrefix().
+ * @param u A unit whose ratio is an SI prefix.
+ * @param engineering Whether to consider only prefixes whose exponent is a multiple of 3.
+ * @return The value in the chosen prefix and the prefix index.
+ */
+template <typename U>
+PrefixedValue AutoPrefix(const U& u, bool engineering = true) noexcept {
+  constexpr size_t from = PrefixIndexOf<U>();
+  static_assert(from != kNoPrefix, "The ratio of the unit must be an SI prefix.");
+  const double value = double(u.GetValue());
+  const size_t to = SelectPrefix(value, from, engineering);
+  return {ConvertPrefix(value, from, to), to};
+}
+
+}  // namespace units
@@ -0,0 +1,222 @@
+#pragma once
+/**
+ * @~english
+ * @file random.hpp
+ * @brief Counter-based (Philox4x32-10) random number generation of typed units in bulk.
+ *
+ * Every sample is a pure function of (seed, stream, sample index), so a stream can be split across threads by
+ * handing each thread a disjoint range of sample indices. The result is identical to generating the whole range on a
+ * single thread and no state is shared between callers.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Philox4x32-10 counter-based generator. Stateless apart from its key, so it can be freely copied and shared.
+ */
+class Philox4x32 {
+ public:
+  /**
+   * @~english
+   * Number of 32-bit words produced per counter block.
+   */
+  static constexpr size_t kBlockWords = 4;
+
+  /**
+   * @~english
+   * Constructor
+   * @param seed The 64-bit key of the generator.
+   * @param stream Independent stream id, stored in the upper half of the counter.
+   */
+  constexpr explicit Philox4x32(uint64_t seed, uint64_t stream = 0) noexcept
+      : k0_(static_cast<uint32_t>(seed)), k1_(static_cast<uint32_t>(seed >> 32)),
+        s0_(static_cast<uint32_t>(stream)), s1_(static_cast<uint32_t>(stream >> 32)) {}
+
+  /**
+   * @~english
+   * Generates the blocks for counters [first, first + count) into four separate word lanes.
+   * The lanes are processed structure-of-arrays so the rounds vectorize.
+   * @param first The first block counter.
+   * @param count The number of blocks to generate.
+   * @param w0 Output lane for word 0 of each block.
+   * @param w1 Output lane for word 1 of each block.
+   * @param w2 Output lane for word 2 of each block.
+   * @param w3 Output lane for word 3 of each block.
+   */
+  void Generate(uint64_t first, size_t count, uint32_t* w0, uint32_t* w1, uint32_t* w2, uint32_t* w3) const noexcept {
+    for (size_t i = 0; i < count; ++i) {
+      const uint64_t block = first + i;
+      w0[i] = static_cast<uint32_t>(block);
+      w1[i] = static_cast<uint32_t>(block >> 32);
+      w2[i] = s0_;
+      w3[i] = s1_;
+    }
+    uint32_t k0 = k0_;
+    uint32_t k1 = k1_;
+    for (int round = 0; round < 10; ++round) {
+      for (size_t i = 0; i < count; ++i) {
+        const uint64_t p0 = uint64_t(kM0) * w0[i];
+        const uint64_t p1 = uint64_t(kM1) * w2[i];
+        const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ w1[i] ^ k0;
+        const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ w3[i] ^ k1;
+        w1[i] = static_cast<uint32_t>(p1);
+        w3[i] = static_cast<uint32_t>(p0);
+        w0[i] = n0;
+        w2[i] = n2;
+      }
+      k0 += kW0;
+      k1 += kW1;
+    }
+  }
+
+ private:
+  static constexpr uint32_t kM0 = 0xD2511F53;
+  static constexpr uint32_t kM1 = 0xCD9E8D57;
+  static constexpr uint32_t kW0 = 0x9E3779B9;
+  static constexpr uint32_t kW1 = 0xBB67AE85;
+
+  uint32_t k0_;
+  uint32_t k1_;
+  uint32_t s0_;
+  uint32_t s1_;
+};
+
+namespace detail {
+
+/**
+ * @~english
+ * Number of samples handled per stack-allocated chunk. Must be even.
+ */
+constexpr size_t kRandomChunk = 256;
+
+/**
+ * @~english
+ * Fills u with the uniform [0, 1) doubles for sample indices [first, first + n), n <= kRandomChunk.
+ * Each block yields two 53-bit doubles, so sample i comes from block i / 2.
+ */
+inline void FillUniform(const Philox4x32& rng, uint64_t first, double* u, size_t n) noexcept {
+  constexpr size_t kBlocks = kRandomChunk / 2 + 1;
+  uint32_t w0[kBlocks], w1[kBlocks], w2[kBlocks], w3[kBlocks];
+  const uint64_t block = first / 2;
+  const size_t offset = static_cast<size_t>(first % 2);
+  const size_t blocks = (offset + n + 1) / 2;
+  rng.Generate(block, blocks, w0, w1, w2, w3);
+
+  double pairs[2 * kBlocks];
+  constexpr double kScale = 1.0 / 9007199254740992.0;  // 2^-53
+  for (size_t i = 0; i < blocks; ++i) {
+    pairs[2 * i] = static_cast<double>(((uint64_t(w0[i]) << 32) | w1[i]) >> 11) * kScale;
+    pairs[2 * i + 1] = static_cast<double>(((uint64_t(w2[i]) << 32) | w3[i]) >> 11) * kScale;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    u[i] = pairs[offset + i];
+  }
+}
+
+/**
+ * @~english
+ * Converts a double sample into the value type of the unit, flooring for integral units.
+ */
+template <typename V>
+inline V FromDouble(double x) noexcept {
+  return std::is_integral<V>::value ? static_cast<V>(std::floor(x)) : static_cast<V>(x);
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * Generates uniformly distributed samples in [lo, hi).
+ * @param rng The generator.
+ * @param first Index of the first sample in the stream.
+ * @param out Output array of n units.
+ * @param n The number of samples.
+ * @param lo The lower bound, in any scale with the same dimensions as U.
+ * @param hi The upper bound, in any scale with the same dimensions as U.
+ */
+template <typename U, typename Lo, typename Hi>
+void GenerateUniform(const Philox4x32& rng, uint64_t first, U* out, size_t n, const Lo& lo, const Hi& hi) noexcept {
+  using V = typename U::value_type;
+  const double a = static_cast<double>(static_cast<U>(lo).GetValue());
+  const double width = static_cast<double>(static_cast<U>(hi).GetValue()) - a;
+  double u[detail::kRandomChunk];
+  for (size_t done = 0; done < n;) {
+    const size_t count = n - done < detail::kRandomChunk ? n - done : detail::kRandomChunk;
+    detail::FillUniform(rng, first + done, u, count);
+    for (size_t i = 0; i < count; ++i) {
+      out[done + i] = U(detail::FromDouble<V>(a + u[i] * width));
+    }
+    done += count;
+  }
+}
+
+/**
+ * @~english
+ * Generates normally distributed samples using the Box-Muller transform. Samples 2k and 2k + 1 share a pair of
+ * uniforms, which is preserved no matter how the index range is split.
+ * @param rng The generator.
+ * @param first Index of the first sample in the stream.
+ * @param out Output array of n units.
+ * @param n The number of samples.
+ * @param mean The mean, in any scale with the same dimensions as U.
+ * @param stddev The standard deviation, in any scale with the same dimensions as U.
+ */
+template <typename U, typename Mean, typename Sigma>
+void GenerateNormal(const Philox4x32& rng, uint64_t first, U* out, size_t n, const Mean& mean,
+                    const Sigma& stddev) noexcept {
+  using V = typename U::value_type;
+  constexpr double kTwoPi = 6.283185307179586476925286766559;
+  const double mu = static_cast<double>(static_cast<U>(mean).GetValue());
+  const double sigma = static_cast<double>(static_cast<U>(stddev).GetValue());
+  double u[detail::kRandomChunk];
+  double z[detail::kRandomChunk];
+  for (size_t done = 0; done < n;) {
+    const uint64_t begin = (first + done) & ~uint64_t(1);
+    const size_t skip = static_cast<size_t>(first + done - begin);
+    const size_t want = n - done < detail::kRandomChunk - 2 ? n - done : detail::kRandomChunk - 2;
+    const size_t count = (skip + want + 1) & ~size_t(1);
+    detail::FillUniform(rng, begin, u, count);
+    for (size_t i = 0; i < count; i += 2) {
+      const double r = std::sqrt(-2.0 * std::log(1.0 - u[i]));
+      z[i] = r * std::cos(kTwoPi * u[i + 1]);
+      z[i + 1] = r * std::sin(kTwoPi * u[i + 1]);
+    }
+    for (size_t i = 0; i < want; ++i) {
+      out[done + i] = U(detail::FromDouble<V>(mu + sigma * z[skip + i]));
+    }
+    done += want;
+  }
+}
+
+/**
+ * @~english
+ * Generates exponentially distributed samples with the given mean (e.g. mean time between events).
+ * @param rng The generator.
+ * @param first Index of the first sample in the stream.
+ * @param out Output array of n units.
+ * @param n The number of samples.
+ * @param mean The mean, in any scale with the same dimensions as U.
+ */
+template <typename U, typename Mean>
+void GenerateExponential(const Philox4x32& rng, uint64_t first, U* out, size_t n, const Mean& mean) noexcept {
+  using V = typename U::value_type;
+  const double mu = static_cast<double>(static_cast<U>(mean).GetValue());
+  double u[detail::kRandomChunk];
+  for (size_t done = 0; done < n;) {
+    const size_t count = n - done < detail::kRandomChunk ? n - done : detail::kRandomChunk;
+    detail::FillUniform(rng, first + done, u, count);
+    for (size_t i = 0; i < count; ++i) {
+      out[done + i] = U(detail::FromDouble<V>(-mu * std::log(1.0 - u[i])));
+    }
+    done += count;
+  }
+}
+
+}  // namespace units
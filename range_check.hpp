@@ -0,0 +1,306 @@
+#pragma once
+/**
+ * @~english
+ * @file range_check.hpp
+ * @brief Batch range checks, clamps and saturating conversions of unit arrays against limits in any ratio.
+ *
+ * The limits are converted into the ratio of the samples once, when a Limits is built, so the kernels compare raw
+ * values without Unit's per-comparison cross-ratio arithmetic. Integer limits are rounded inward (the lower limit up,
+ * the upper limit down) and saturate instead of overflowing, which keeps the check exact. Checks first build one
+ * 64-bit violation mask per 64 samples with a branch-free loop, then either store the masks as a bitmap or expand them
+ * into a compressed list of violation indices, so the cost of the expansion is proportional to the violations.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <type_traits>
+#include <vector>
+
+#include "parallel.hpp"
+#include "unit.hpp"
+
+namespace units {
+namespace detail {
+
+/**
+ * @~english
+ * Whether a value falls outside [lo, hi]. NaN is outside.
+ */
+template <typename T>
+bool OutOfRange(T v, T lo, T hi) noexcept {
+  return !(v >= lo && v <= hi);
+}
+
+/**
+ * @~english
+ * Builds the violation mask of up to 64 samples, bit b standing for in[b].
+ */
+template <typename U, typename T>
+uint64_t ViolationMask(const U* in, size_t count, T lo, T hi) noexcept {
+  uint64_t mask = 0;
+  for (size_t b = 0; b < count; ++b) mask |= uint64_t(OutOfRange(in[b].GetValue(), lo, hi)) << b;
+  return mask;
+}
+
+inline size_t PopCount(uint64_t mask) noexcept {
+#if defined(__GNUC__)
+  return size_t(__builtin_popcountll(mask));
+#else
+  size_t count = 0;
+  for (; mask != 0; mask &= mask - 1) ++count;
+  return count;
+#endif
+}
+
+inline size_t LowestBit(uint64_t mask) noexcept {
+#if defined(__GNUC__)
+  return size_t(__builtin_ctzll(mask));
+#else
+  size_t b = 0;
+  while ((mask & 1) == 0) {
+    mask >>= 1;
+    ++b;
+  }
+  return b;
+#endif
+}
+
+/**
+ * @~english
+ * Narrows x into an integer, saturating at its range. NaN becomes 0.
+ * @return Whether x was out of range or NaN.
+ */
+template <typename T>
+bool Saturate(long double x, T* out, std::true_type) noexcept {
+  const long double lowest = static_cast<long double>(std::numeric_limits<T>::lowest());
+  const long double highest = static_cast<long double>(std::numeric_limits<T>::max());
+  if (x != x) {
+    *out = 0;
+    return true;
+  }
+  // The bounds may round up in magnitude when long double is double, so they are excluded from the cast.
+  if (x >= highest) {
+    *out = std::numeric_limits<T>::max();
+    return x > highest;
+  }
+  if (x <= lowest) {
+    *out = std::numeric_limits<T>::lowest();
+    return x < lowest;
+  }
+  *out = static_cast<T>(x);
+  return false;
+}
+
+/**
+ * @~english
+ * Narrows x into a floating point type, saturating finite values at its range.
+ * @return Whether a finite x was out of range.
+ */
+template <typename T>
+bool Saturate(long double x, T* out, std::false_type) noexcept {
+  const bool finite = x - x == 0;
+  if (finite && x > static_cast<long double>(std::numeric_limits<T>::max())) {
+    *out = std::numeric_limits<T>::max();
+    return true;
+  }
+  if (finite && x < static_cast<long double>(std::numeric_limits<T>::lowest())) {
+    *out = std::numeric_limits<T>::lowest();
+    return true;
+  }
+  *out = static_cast<T>(x);
+  return false;
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * @brief Closed range [lower, upper] of a unit U, built from limits in any ratio of U.
+ */
+template <typename U>
+class Limits {
+ public:
+  using value_type = typename U::value_type;
+
+  /**
+   * @~english
+   * Constructor. A lower limit above the upper limit makes every sample a violation.
+   * @param lower The lower limit, in any ratio of the same units and value type.
+   * @param upper The upper limit, in any ratio of the same units and value type.
+   */
+  template <typename L, typename H>
+  Limits(const L& lower, const H& upper) noexcept : lower_(Convert(lower, true)), upper_(Convert(upper, false)) {}
+
+  /**
+   * @~english
+   * Only a lower limit, e.g. for non-negative quantities.
+   */
+  template <typename L>
+  static Limits AtLeast(const L& lower) noexcept {
+    return Limits(lower, U(std::numeric_limits<value_type>::has_infinity ? std::numeric_limits<value_type>::infinity()
+                                                                          : std::numeric_limits<value_type>::max()));
+  }
+
+  /**
+   * @~english
+   * Only an upper limit, e.g. temperature below 380 K.
+   */
+  template <typename H>
+  static Limits AtMost(const H& upper) noexcept {
+    return Limits(U(std::numeric_limits<value_type>::has_infinity ? -std::numeric_limits<value_type>::infinity()
+                                                                   : std::numeric_limits<value_type>::lowest()),
+                  upper);
+  }
+
+  /**
+   * @~english
+   * Gets the lower limit in the ratio of U, rounded up for integers.
+   */
+  value_type GetLower() const noexcept { return lower_; }
+
+  /**
+   * @~english
+   * Gets the upper limit in the ratio of U, rounded down for integers.
+   */
+  value_type GetUpper() const noexcept { return upper_; }
+
+  /**
+   * @~english
+   * Checks one sample.
+   */
+  bool Contains(const U& u) const noexcept { return !detail::OutOfRange(u.GetValue(), lower_, upper_); }
+
+ private:
+  template <typename L>
+  static value_type Convert(const L& limit, bool up) noexcept {
+    static_assert(std::is_same<typename L::template units<1, 1>, typename U::template units<1, 1>>::value,
+                  "Limits require identical units and value type.");
+    using s = std::ratio_divide<typename L::scale, typename U::scale>;
+    return detail::RescaleRounded<s>(limit.GetValue(), up);
+  }
+
+  value_type lower_;
+  value_type upper_;
+};
+
+/**
+ * @~english
+ * Marks the samples outside the limits in a bitmap, bit i % 64 of word i / 64 standing for sample i.
+ * @param in The samples.
+ * @param n The number of samples.
+ * @param limits The limits.
+ * @param bitmap Receives (n + 63) / 64 words. Bits past n are zero.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ * @return The number of violations.
+ */
+template <typename U>
+size_t CheckRange(const U* in, size_t n, const Limits<U>& limits, uint64_t* bitmap, unsigned threads = 0) {
+  const auto lo = limits.GetLower(), hi = limits.GetUpper();
+  std::atomic<size_t> violations(0);
+  detail::ParallelFor((n + 63) / 64, threads, [&](size_t begin, size_t end) {
+    size_t count = 0;
+    for (size_t w = begin; w < end; ++w) {
+      bitmap[w] = detail::ViolationMask(in + w * 64, std::min<size_t>(64, n - w * 64), lo, hi);
+      count += detail::PopCount(bitmap[w]);
+    }
+    violations += count;
+  });
+  return violations;
+}
+
+/**
+ * @~english
+ * Lists the indices of the samples outside the limits, in ascending order.
+ * @param in The samples.
+ * @param n The number of samples.
+ * @param limits The limits.
+ * @param indices Receives the indices. Must have room for n indices, as every thread writes its violations at the
+ * offset of its own chunk before they are compacted.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ * @return The number of violations.
+ */
+template <typename U>
+size_t FindViolations(const U* in, size_t n, const Limits<U>& limits, size_t* indices, unsigned threads = 0) {
+  const auto lo = limits.GetLower(), hi = limits.GetUpper();
+  const size_t words = (n + 63) / 64;
+  const unsigned tasks = static_cast<unsigned>(std::min<size_t>(detail::ThreadCount(threads), std::max<size_t>(1, words)));
+  const size_t chunk = (words + tasks - 1) / tasks;
+  std::vector<size_t> counts(tasks, 0);
+  detail::ParallelTasks(tasks, [&](unsigned t) {
+    const size_t first = std::min(n, t * chunk * 64);
+    size_t* out = indices + first;
+    for (size_t w = t * chunk; w < std::min(words, (t + 1) * chunk); ++w) {
+      for (uint64_t mask = detail::ViolationMask(in + w * 64, std::min<size_t>(64, n - w * 64), lo, hi); mask != 0;
+           mask &= mask - 1) {
+        *out++ = w * 64 + detail::LowestBit(mask);
+      }
+    }
+    counts[t] = size_t(out - (indices + first));
+  });
+  size_t total = counts[0];
+  for (unsigned t = 1; t < tasks; ++t) {
+    const size_t* first = indices + std::min(n, t * chunk * 64);
+    std::copy(first, first + counts[t], indices + total);
+    total += counts[t];
+  }
+  return total;
+}
+
+/**
+ * @~english
+ * Clamps samples into the limits. NaN samples are copied unchanged.
+ * @param in The samples.
+ * @param out The clamped samples. May alias in.
+ * @param n The number of samples.
+ * @param limits The limits.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ * @return The number of samples that were out of range, NaN included.
+ */
+template <typename U>
+size_t Clamp(const U* in, U* out, size_t n, const Limits<U>& limits, unsigned threads = 0) {
+  const auto lo = limits.GetLower(), hi = limits.GetUpper();
+  std::atomic<size_t> clamped(0);
+  detail::ParallelFor(n, threads, [&](size_t begin, size_t end) {
+    size_t count = 0;
+    for (size_t i = begin; i < end; ++i) {
+      const auto v = in[i].GetValue();
+      count += detail::OutOfRange(v, lo, hi);
+      out[i] = U(v < lo ? lo : v > hi ? hi : v);
+    }
+    clamped += count;
+  });
+  return clamped;
+}
+
+/**
+ * @~english
+ * Converts samples into another ratio and value type of the same units, saturating at the range of the target value
+ * type instead of overflowing. The product is formed in long double. Integer targets truncate like Unit conversions
+ * and receive 0 for NaN; floating point targets keep infinities and NaN.
+ * @param in The samples.
+ * @param out The converted samples.
+ * @param n The number of samples.
+ * @return The number of samples that saturated, NaN included for integer targets.
+ */
+template <typename To, typename From>
+size_t SaturateConvert(const From* in, To* out, size_t n) noexcept {
+  static_assert(std::is_same<typename From::template units<1, 1>,
+                             typename To::template units<1, 1>::template rebind<typename From::value_type>>::value,
+                "Conversion requires identical units.");
+  using T = typename To::value_type;
+  using s = std::ratio_divide<typename From::scale, typename To::scale>;
+  const long double factor = static_cast<long double>(s::num) / static_cast<long double>(s::den);
+  size_t saturated = 0;
+  for (size_t i = 0; i < n; ++i) {
+    T v;
+    saturated += detail::Saturate(static_cast<long double>(in[i].GetValue()) * factor, &v, std::is_integral<T>());
+    out[i] = To(v);
+  }
+  return saturated;
+}
+
+}  // namespace units
@@ -0,0 +1,358 @@
+#pragma once
+/**
+ * @~english
+ * @file registry.hpp
+ * @brief Registry of units defined at run time, resolved by symbol through a perfect hash.
+ *
+ * A UnitTable is an immutable snapshot of definitions. Building one picks hash seeds by hash-and-displace: symbols are
+ * grouped into buckets by their hash, and each bucket, largest first, searches for a seed that moves all of its
+ * symbols to free slots. A lookup hashes the symbol once, remixes the hash with its bucket's seed and compares the one
+ * candidate slot.
+ *
+ * A UnitRegistry publishes tables read-copy-update style. Readers pin the current table with one atomic increment and
+ * never block; Load() builds the new table off to the side, publishes it with one store and frees the old table after a
+ * grace period in which every reader that could still see it has finished.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "dimensions.hpp"
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief A unit defined at run time by its symbol, exponents and exact ratio.
+ */
+struct UnitDefinition {
+  std::string symbol;
+  std::array<int32_t, 7> exponents;
+  uint64_t num;
+  uint64_t den;
+
+  /**
+   * @~english
+   * Describes a compile-time unit.
+   */
+  template <typename U>
+  static UnitDefinition Of(std::string symbol) {
+    return {std::move(symbol), Dimensions::Of<U>().exponents, U::GetNum(), U::GetDen()};
+  }
+
+  Dimensions GetDimensions() const noexcept { return {exponents, double(num) / double(den)}; }
+};
+
+/**
+ * @~english
+ * Parses unit definitions, one per line: a symbol, the seven exponents in Unit's order and the ratio as num or
+ * num/den. Blank lines and lines starting with '#' are ignored, e.g. "U 0 1 0 0 0 0 0 889/20000" for a rack unit.
+ * @param text The definitions.
+ * @param out The parsed definitions are appended to out.
+ * @param error Receives a description of the first malformed line. May be null.
+ * @return True on success.
+ */
+inline bool ParseUnitDefinitions(const std::string& text, std::vector<UnitDefinition>* out,
+                                 std::string* error = nullptr) {
+  std::istringstream lines(text);
+  std::string line;
+  for (size_t number = 1; std::getline(lines, line); ++number) {
+    std::istringstream fields(line);
+    UnitDefinition unit{};
+    if (!(fields >> unit.symbol) || unit.symbol[0] == '#') continue;
+    bool ok = true;
+    for (auto& e : unit.exponents) ok = ok && static_cast<bool>(fields >> e);
+    std::string ratio;
+    ok = ok && static_cast<bool>(fields >> ratio);
+    if (ok) {
+      const size_t slash = ratio.find('/');
+      const std::string num = ratio.substr(0, slash);
+      const std::string den = slash == std::string::npos ? "1" : ratio.substr(slash + 1);
+      // Parses decimal digits into a non-zero uint64_t, failing instead of wrapping on overflow.
+      const auto parse = [](const std::string& s, uint64_t* value) {
+        *value = 0;
+        for (char c : s) {
+          if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+          const uint64_t digit = uint64_t(c - '0');
+          if (*value > (std::numeric_limits<uint64_t>::max() - digit) / 10) return false;
+          *value = *value * 10 + digit;
+        }
+        return *value != 0;
+      };
+      ok = parse(num, &unit.num) && parse(den, &unit.den);
+    }
+    std::string rest;
+    if (!ok || fields >> rest) {
+      if (error != nullptr) *error = "malformed unit definition on line " + std::to_string(number);
+      return false;
+    }
+    out->push_back(std::move(unit));
+  }
+  return true;
+}
+
+namespace detail {
+
+inline uint64_t MixHash(uint64_t h) noexcept {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  return h ^ (h >> 33);
+}
+
+inline uint64_t HashSymbol(const char* symbol, size_t size) noexcept {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    h = (h ^ static_cast<unsigned char>(symbol[i])) * 0x100000001b3ULL;
+  }
+  return MixHash(h);
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * @brief Immutable set of unit definitions with perfect-hash lookup by symbol.
+ */
+class UnitTable {
+ public:
+  UnitTable() = default;
+
+  /**
+   * @~english
+   * Builds a table.
+   * @param units The definitions.
+   * @param table Receives the table on success.
+   * @param error Receives the first duplicate symbol on failure. May be null.
+   * @return True on success.
+   */
+  static bool Build(std::vector<UnitDefinition> units, UnitTable* table, std::string* error = nullptr) {
+    std::vector<uint64_t> hashes(units.size());
+    for (size_t i = 0; i < units.size(); ++i) {
+      hashes[i] = detail::HashSymbol(units[i].symbol.data(), units[i].symbol.size());
+    }
+    std::vector<size_t> order(units.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return units[a].symbol < units[b].symbol; });
+    for (size_t i = 1; i < order.size(); ++i) {
+      if (units[order[i]].symbol == units[order[i - 1]].symbol) {
+        if (error != nullptr) *error = "duplicate unit symbol '" + units[order[i]].symbol + "'";
+        return false;
+      }
+    }
+    for (size_t slots = units.size() + units.size() / 4 + 1;; slots += slots / 4 + 1) {
+      if (table->Place(units, hashes, slots)) return true;
+    }
+  }
+
+  size_t Size() const noexcept { return size_; }
+
+  /**
+   * @~english
+   * Looks up a symbol.
+   * @param symbol The symbol.
+   * @return The definition, or null if the symbol is unknown. Valid as long as the table.
+   */
+  const UnitDefinition* Find(const std::string& symbol) const noexcept {
+    if (size_ == 0) return nullptr;
+    const uint64_t h = detail::HashSymbol(symbol.data(), symbol.size());
+    const UnitDefinition& slot = slots_[Slot(h, seeds_[h % seeds_.size()])];
+    return slot.symbol == symbol && !slot.symbol.empty() ? &slot : nullptr;
+  }
+
+ private:
+  /**
+   * @~english
+   * Average number of symbols per bucket.
+   */
+  static constexpr size_t kBucketSize = 4;
+
+  /**
+   * @~english
+   * Seeds tried per bucket before the table is grown.
+   */
+  static constexpr uint32_t kMaxSeed = 1 << 16;
+
+  size_t Slot(uint64_t hash, uint32_t seed) const noexcept {
+    return detail::MixHash(hash ^ (uint64_t(seed) * 0x9e3779b97f4a7c15ULL)) % slots_.size();
+  }
+
+  bool Place(std::vector<UnitDefinition>& units, const std::vector<uint64_t>& hashes, size_t slots) {
+    const size_t buckets = units.size() / kBucketSize + 1;
+    std::vector<std::vector<size_t>> members(buckets);
+    for (size_t i = 0; i < units.size(); ++i) members[hashes[i] % buckets].push_back(i);
+    std::vector<size_t> order(buckets);
+    for (size_t b = 0; b < buckets; ++b) order[b] = b;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return members[a].size() > members[b].size(); });
+
+    slots_.assign(slots, UnitDefinition{});
+    seeds_.assign(buckets, 0);
+    std::vector<bool> taken(slots, false);
+    std::vector<size_t> placed;
+    for (size_t b : order) {
+      if (members[b].empty()) break;
+      uint32_t seed = 0;
+      for (; seed < kMaxSeed; ++seed) {
+        placed.clear();
+        for (size_t i : members[b]) {
+          const size_t s = Slot(hashes[i], seed);
+          if (taken[s] || std::find(placed.begin(), placed.end(), s) != placed.end()) break;
+          placed.push_back(s);
+        }
+        if (placed.size() == members[b].size()) break;
+      }
+      if (seed == kMaxSeed) return false;
+      seeds_[b] = seed;
+      for (size_t k = 0; k < placed.size(); ++k) taken[placed[k]] = true;
+    }
+    for (size_t i = 0; i < units.size(); ++i) {
+      slots_[Slot(hashes[i], seeds_[hashes[i] % buckets])] = std::move(units[i]);
+    }
+    size_ = units.size();
+    return true;
+  }
+
+  std::vector<UnitDefinition> slots_;
+  std::vector<uint32_t> seeds_;
+  size_t size_ = 0;
+};
+
+/**
+ * @~english
+ * @brief Publishes UnitTable snapshots to lock-free readers.
+ */
+class UnitRegistry {
+ public:
+  /**
+   * @~english
+   * @brief Pins the table that was current when it was created. Readers should hold one only briefly, since Load()
+   * waits for it.
+   */
+  class Reader {
+   public:
+    Reader(Reader&& other) noexcept : registry_(other.registry_), phase_(other.phase_), table_(other.table_) {
+      other.registry_ = nullptr;
+    }
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    ~Reader() {
+      if (registry_ != nullptr) registry_->readers_[phase_].fetch_sub(1, std::memory_order_release);
+    }
+
+    const UnitTable& operator*() const noexcept { return *table_; }
+    const UnitTable* operator->() const noexcept { return table_; }
+
+   private:
+    friend class UnitRegistry;
+    explicit Reader(const UnitRegistry* registry) : registry_(registry) {
+      phase_ = registry->phase_.load(std::memory_order_seq_cst);
+      registry->readers_[phase_].fetch_add(1, std::memory_order_seq_cst);
+      table_ = registry->current_.load(std::memory_order_seq_cst);
+    }
+
+    const UnitRegistry* registry_;
+    unsigned phase_;
+    const UnitTable* table_;
+  };
+
+  UnitRegistry() : current_(new UnitTable()) {
+    readers_[0] = 0;
+    readers_[1] = 0;
+  }
+
+  UnitRegistry(const UnitRegistry&) = delete;
+  UnitRegistry& operator=(const UnitRegistry&) = delete;
+
+  ~UnitRegistry() { delete current_.load(); }
+
+  /**
+   * @~english
+   * Pins the current table. Never blocks.
+   */
+  Reader Read() const { return Reader(this); }
+
+  /**
+   * @~english
+   * Replaces the published table. Concurrent loads are serialized.
+   * @param units The new definitions.
+   * @param error Receives a description of the problem on failure. May be null.
+   * @return True if the new table was published. On failure the current table stays published.
+   */
+  bool Load(std::vector<UnitDefinition> units, std::string* error = nullptr) {
+    std::unique_ptr<UnitTable> table(new UnitTable());
+    if (!UnitTable::Build(std::move(units), table.get(), error)) return false;
+    std::lock_guard<std::mutex> lock(writer_);
+    std::unique_ptr<const UnitTable> old(current_.exchange(table.release(), std::memory_order_seq_cst));
+    // Two phase flips: a reader that sampled the phase before the first flip is drained by the second wait.
+    for (int flip = 0; flip < 2; ++flip) {
+      const unsigned phase = phase_.load(std::memory_order_relaxed);
+      phase_.store(phase ^ 1u, std::memory_order_seq_cst);
+      // Sequentially consistent like the reader's increment, so a reader that missed the flip is seen here.
+      while (readers_[phase].load(std::memory_order_seq_cst) != 0) std::this_thread::yield();
+    }
+    return true;
+  }
+
+ private:
+  std::atomic<const UnitTable*> current_;
+  mutable std::atomic<unsigned> phase_{0};
+  mutable std::atomic<size_t> readers_[2];
+  std::mutex writer_;
+};
+
+/**
+ * @~english
+ * Lists the definitions of the base units and their prefixed forms, e.g. "s", "ms", "km", "ug", "GA". Micro is "u".
+ * @return The definitions.
+ */
+inline std::vector<UnitDefinition> SiUnitDefinitions() {
+  static const char* const kSymbols[] = {"s", "m", "cd", "K", "rad", "A", "g"};
+  struct Prefix {
+    const char* symbol;
+    uint64_t num;
+    uint64_t den;
+  };
+  static const Prefix kPrefixes[] = {{"", 1, 1},
+                                     {"a", 1, 1000000000000000000ULL},
+                                     {"f", 1, 1000000000000000ULL},
+                                     {"p", 1, 1000000000000ULL},
+                                     {"n", 1, 1000000000},
+                                     {"u", 1, 1000000},
+                                     {"m", 1, 1000},
+                                     {"c", 1, 100},
+                                     {"d", 1, 10},
+                                     {"da", 10, 1},
+                                     {"h", 100, 1},
+                                     {"k", 1000, 1},
+                                     {"M", 1000000, 1},
+                                     {"G", 1000000000, 1},
+                                     {"T", 1000000000000ULL, 1},
+                                     {"P", 1000000000000000ULL, 1},
+                                     {"E", 1000000000000000000ULL, 1}};
+  std::vector<UnitDefinition> units;
+  for (size_t base = 0; base < 7; ++base) {
+    for (const Prefix& prefix : kPrefixes) {
+      UnitDefinition unit{std::string(prefix.symbol) + kSymbols[base], {}, prefix.num, prefix.den};
+      unit.exponents[base] = 1;
+      units.push_back(std::move(unit));
+    }
+  }
+  return units;
+}
+
+}  // namespace units
@@ -0,0 +1,252 @@
+#pragma once
+/**
+ * @~english
+ * @file rotation.hpp
+ * @brief Quaternions and rotation matrices with radian-typed angles, rotating unit-typed vectors.
+ *
+ * Angle-based constructors take any angle unit (e.g. d::Radian, d::Milliradian or d::Degree from nonsi.hpp) and
+ * convert it to radians once. Rotating a Vec3<U> yields a Vec3<U>. Batch transforms convert the quaternion to a
+ * matrix once and run over structure-of-arrays coordinates so they vectorize.
+ */
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Three-component vector of units.
+ */
+template <typename U>
+struct Vec3 {
+  U x;
+  U y;
+  U z;
+
+  constexpr Vec3 operator+(const Vec3& o) const { return {U(x.GetValue() + o.x.GetValue()),
+                                                          U(y.GetValue() + o.y.GetValue()),
+                                                          U(z.GetValue() + o.z.GetValue())}; }
+  constexpr Vec3 operator-(const Vec3& o) const { return {U(x.GetValue() - o.x.GetValue()),
+                                                          U(y.GetValue() - o.y.GetValue()),
+                                                          U(z.GetValue() - o.z.GetValue())}; }
+};
+
+namespace detail {
+
+/**
+ * @~english
+ * Converts any angle unit into a plain radian value.
+ */
+template <typename T, typename A>
+T ToRadians(const A& angle) noexcept {
+  return static_cast<Unit<T, 0, 0, 0, 0, 1, 0, 0>>(angle).GetValue();
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * @brief Row-major 3x3 rotation matrix.
+ */
+template <typename T>
+class RotationMatrix {
+ public:
+  static_assert(std::is_floating_point<T>::value, "Only floating point rotations supported.");
+
+  /**
+   * @~english
+   * Constructor
+   * @param m The row-major elements.
+   */
+  constexpr explicit RotationMatrix(const std::array<T, 9>& m) : m_(m) {}
+
+  constexpr T operator()(size_t row, size_t col) const noexcept { return m_[3 * row + col]; }
+
+  /**
+   * @~english
+   * Rotates a vector.
+   * @param v The vector.
+   * @return The rotated vector, in the same units.
+   */
+  template <typename U>
+  Vec3<U> Rotate(const Vec3<U>& v) const noexcept {
+    const T x = v.x.GetValue(), y = v.y.GetValue(), z = v.z.GetValue();
+    return {U(m_[0] * x + m_[1] * y + m_[2] * z), U(m_[3] * x + m_[4] * y + m_[5] * z),
+            U(m_[6] * x + m_[7] * y + m_[8] * z)};
+  }
+
+  /**
+   * @~english
+   * Rotates structure-of-arrays coordinates. Outputs may alias inputs.
+   * @param x, y, z The input coordinates.
+   * @param ox, oy, oz The rotated coordinates.
+   * @param n The number of points.
+   */
+  template <typename U>
+  void RotateBatch(const U* x, const U* y, const U* z, U* ox, U* oy, U* oz, size_t n) const noexcept {
+    const T m0 = m_[0], m1 = m_[1], m2 = m_[2], m3 = m_[3], m4 = m_[4], m5 = m_[5], m6 = m_[6], m7 = m_[7],
+            m8 = m_[8];
+    for (size_t i = 0; i < n; ++i) {
+      const T a = x[i].GetValue(), b = y[i].GetValue(), c = z[i].GetValue();
+      ox[i] = U(m0 * a + m1 * b + m2 * c);
+      oy[i] = U(m3 * a + m4 * b + m5 * c);
+      oz[i] = U(m6 * a + m7 * b + m8 * c);
+    }
+  }
+
+  /**
+   * @~english
+   * Rotates an array of vectors. Output may alias input.
+   * @param in The vectors.
+   * @param out The rotated vectors.
+   * @param n The number of vectors.
+   */
+  template <typename U>
+  void RotateBatch(const Vec3<U>* in, Vec3<U>* out, size_t n) const noexcept {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = Rotate(in[i]);
+    }
+  }
+
+ private:
+  std::array<T, 9> m_;
+};
+
+/**
+ * @~english
+ * @brief Rotation quaternion w + xi + yj + zk.
+ */
+template <typename T>
+class Quaternion {
+ public:
+  static_assert(std::is_floating_point<T>::value, "Only floating point quaternions supported.");
+
+  /**
+   * @~english
+   * Constructor
+   * @param w, x, y, z The components.
+   */
+  constexpr Quaternion(T w = T(1), T x = T(0), T y = T(0), T z = T(0)) : w_(w), x_(x), y_(y), z_(z) {}
+
+  /**
+   * @~english
+   * Creates a rotation about an axis.
+   * @param axis The rotation axis. Need not be normalized.
+   * @param angle The rotation angle, in any angle unit.
+   * @return The rotation.
+   */
+  template <typename A>
+  static Quaternion FromAxisAngle(const std::array<T, 3>& axis, const A& angle) noexcept {
+    const T half = detail::ToRadians<T>(angle) / 2;
+    const T norm = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    const T s = std::sin(half) / norm;
+    return {std::cos(half), axis[0] * s, axis[1] * s, axis[2] * s};
+  }
+
+  /**
+   * @~english
+   * Creates a rotation from intrinsic Z-Y-X (yaw, pitch, roll) Euler angles.
+   * @param roll Rotation about x, in any angle unit.
+   * @param pitch Rotation about y, in any angle unit.
+   * @param yaw Rotation about z, in any angle unit.
+   * @return The rotation.
+   */
+  template <typename R, typename P, typename Y>
+  static Quaternion FromEuler(const R& roll, const P& pitch, const Y& yaw) noexcept {
+    const T cr = std::cos(detail::ToRadians<T>(roll) / 2), sr = std::sin(detail::ToRadians<T>(roll) / 2);
+    const T cp = std::cos(detail::ToRadians<T>(pitch) / 2), sp = std::sin(detail::ToRadians<T>(pitch) / 2);
+    const T cy = std::cos(detail::ToRadians<T>(yaw) / 2), sy = std::sin(detail::ToRadians<T>(yaw) / 2);
+    return {cr * cp * cy + sr * sp * sy, sr * cp * cy - cr * sp * sy, cr * sp * cy + sr * cp * sy,
+            cr * cp * sy - sr * sp * cy};
+  }
+
+  constexpr T GetW() const noexcept { return w_; }
+  constexpr T GetX() const noexcept { return x_; }
+  constexpr T GetY() const noexcept { return y_; }
+  constexpr T GetZ() const noexcept { return z_; }
+
+  /**
+   * @~english
+   * Gets the rotation angle.
+   * @return The angle in [0, 2 pi] radians.
+   */
+  Unit<T, 0, 0, 0, 0, 1, 0, 0> GetAngle() const noexcept {
+    return 2 * std::atan2(std::sqrt(x_ * x_ + y_ * y_ + z_ * z_), w_);
+  }
+
+  constexpr Quaternion Conjugate() const noexcept { return {w_, -x_, -y_, -z_}; }
+
+  Quaternion Normalized() const noexcept {
+    const T inv = T(1) / std::sqrt(w_ * w_ + x_ * x_ + y_ * y_ + z_ * z_);
+    return {w_ * inv, x_ * inv, y_ * inv, z_ * inv};
+  }
+
+  /**
+   * @~english
+   * Composes rotations: (a * b) rotates by b first, then by a.
+   */
+  constexpr Quaternion operator*(const Quaternion& o) const noexcept {
+    return {w_ * o.w_ - x_ * o.x_ - y_ * o.y_ - z_ * o.z_, w_ * o.x_ + x_ * o.w_ + y_ * o.z_ - z_ * o.y_,
+            w_ * o.y_ - x_ * o.z_ + y_ * o.w_ + z_ * o.x_, w_ * o.z_ + x_ * o.y_ - y_ * o.x_ + z_ * o.w_};
+  }
+
+  /**
+   * @~english
+   * Converts a unit quaternion into a rotation matrix.
+   * @return The rotation matrix.
+   */
+  RotationMatrix<T> ToMatrix() const noexcept {
+    const T xx = x_ * x_, yy = y_ * y_, zz = z_ * z_;
+    const T xy = x_ * y_, xz = x_ * z_, yz = y_ * z_;
+    const T wx = w_ * x_, wy = w_ * y_, wz = w_ * z_;
+    return RotationMatrix<T>(std::array<T, 9>{{1 - 2 * (yy + zz), 2 * (xy - wz), 2 * (xz + wy),
+                                               2 * (xy + wz), 1 - 2 * (xx + zz), 2 * (yz - wx),
+                                               2 * (xz - wy), 2 * (yz + wx), 1 - 2 * (xx + yy)}});
+  }
+
+  /**
+   * @~english
+   * Rotates a vector by a unit quaternion.
+   * @param v The vector.
+   * @return The rotated vector, in the same units.
+   */
+  template <typename U>
+  Vec3<U> Rotate(const Vec3<U>& v) const noexcept {
+    // v' = v + 2w (q x v) + 2 q x (q x v)
+    const T vx = v.x.GetValue(), vy = v.y.GetValue(), vz = v.z.GetValue();
+    const T tx = 2 * (y_ * vz - z_ * vy), ty = 2 * (z_ * vx - x_ * vz), tz = 2 * (x_ * vy - y_ * vx);
+    return {U(vx + w_ * tx + (y_ * tz - z_ * ty)), U(vy + w_ * ty + (z_ * tx - x_ * tz)),
+            U(vz + w_ * tz + (x_ * ty - y_ * tx))};
+  }
+
+  /**
+   * @~english
+   * Rotates structure-of-arrays coordinates through the equivalent matrix. Outputs may alias inputs.
+   */
+  template <typename U>
+  void RotateBatch(const U* x, const U* y, const U* z, U* ox, U* oy, U* oz, size_t n) const noexcept {
+    ToMatrix().RotateBatch(x, y, z, ox, oy, oz, n);
+  }
+
+  /**
+   * @~english
+   * Rotates an array of vectors through the equivalent matrix. Output may alias input.
+   */
+  template <typename U>
+  void RotateBatch(const Vec3<U>* in, Vec3<U>* out, size_t n) const noexcept {
+    ToMatrix().RotateBatch(in, out, n);
+  }
+
+ private:
+  T w_;
+  T x_;
+  T y_;
+  T z_;
+};
+
+}  // namespace units
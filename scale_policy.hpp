@@ -0,0 +1,234 @@
+#pragma once
+/**
+ * @~english
+ * @file scale_policy.hpp
+ * @brief Opt-in policies choosing the ratio of sums of units in different ratios.
+ *
+ * Unit::operator+ returns the gcd of the numerators over the lcm of the denominators. That ratio is exact, but a chain
+ * of mixed prefixes can drift to ratios such as 1/21 that are then rescaled again, or that overflow integer ranges.
+ * ScaledSum() adds any number of terms in one step and picks the result ratio at compile time from the terms' own ratios:
+ * usually the ratio shared by the most terms, so the fewest terms need a rescale, with ties broken by the policy. Every
+ * other term is rescaled once, directly into the result, by a folded constant.
+ *
+ * Only CommonScale is always exact. For integral value types, CoarserScale and LeftScale truncate every term finer than
+ * the result, like a Unit conversion would. The policies rescale fewer terms than a chain of operator+ only when that
+ * chain drifts to a ratio none of the terms has, as in m/7 + m/3, or when CoarserScale truncates the finer terms; with
+ * FinerScale, mixes of SI prefixes rescale as often as operator+ and run at the same speed, see
+ * benchmark/scale_policy.cpp.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "unit.hpp"
+
+namespace units {
+namespace detail {
+
+struct ScaleEntry {
+  intmax_t num;
+  intmax_t den;
+  bool integral;
+};
+
+constexpr bool SameScale(const ScaleEntry& a, const ScaleEntry& b) noexcept { return a.num == b.num && a.den == b.den; }
+
+constexpr bool ScaleLess(const ScaleEntry& a, const ScaleEntry& b) noexcept {
+  return static_cast<long double>(a.num) / a.den < static_cast<long double>(b.num) / b.den;
+}
+
+/**
+ * @~english
+ * Index of the ratio shared by the most entries, searching from entry i on. Among equally common ratios,
+ * Prefer::Wins(a, b) decides whether a wins.
+ */
+template <typename Prefer>
+constexpr size_t ModeScale(const ScaleEntry* e, size_t n, size_t i = 0, size_t best = 0,
+                           size_t best_count = 0) noexcept;
+
+constexpr size_t CountScale(const ScaleEntry* e, size_t n, const ScaleEntry& x) noexcept {
+  return n == 0 ? 0 : SameScale(e[n - 1], x) + CountScale(e, n - 1, x);
+}
+
+template <typename Prefer>
+constexpr size_t ModeStep(const ScaleEntry* e, size_t n, size_t i, size_t best, size_t best_count,
+                          size_t count) noexcept {
+  return count > best_count || (count == best_count && Prefer::Wins(e[i], e[best]))
+             ? ModeScale<Prefer>(e, n, i + 1, i, count)
+             : ModeScale<Prefer>(e, n, i + 1, best, best_count);
+}
+
+template <typename Prefer>
+constexpr size_t ModeScale(const ScaleEntry* e, size_t n, size_t i, size_t best, size_t best_count) noexcept {
+  return i == n ? best : ModeStep<Prefer>(e, n, i, best, best_count, CountScale(e, n, e[i]));
+}
+
+/**
+ * @~english
+ * Index of the finest ratio, the first one on ties.
+ */
+constexpr size_t FinestScale(const ScaleEntry* e, size_t n, size_t i = 1, size_t best = 0) noexcept {
+  return i >= n ? best : FinestScale(e, n, i + 1, ScaleLess(e[i], e[best]) ? i : best);
+}
+
+struct PreferFiner {
+  static constexpr bool Wins(const ScaleEntry& a, const ScaleEntry& b) noexcept { return ScaleLess(a, b); }
+};
+
+struct PreferCoarser {
+  static constexpr bool Wins(const ScaleEntry& a, const ScaleEntry& b) noexcept { return ScaleLess(b, a); }
+};
+
+}  // namespace detail
+
+/**
+ * @~english
+ * @brief For integral value types the finest ratio among the terms, which truncates only terms whose ratio is not a
+ * multiple of it, e.g. 1/3 m into 1/7 m. For floating point types the most common ratio, preferring the finest on ties.
+ */
+struct FinerScale {
+  static constexpr size_t Choose(const detail::ScaleEntry* e, size_t n) noexcept {
+    return e[0].integral ? detail::FinestScale(e, n) : detail::ModeScale<detail::PreferFiner>(e, n);
+  }
+};
+
+/**
+ * @~english
+ * @brief The most common ratio among the terms, preferring the coarsest on ties. Keeps integer values smallest, but
+ * truncates integral terms finer than the result, e.g. 150 cm becomes 1 m in a sum in meters.
+ */
+struct CoarserScale {
+  static constexpr size_t Choose(const detail::ScaleEntry* e, size_t n) noexcept {
+    return detail::ModeScale<detail::PreferCoarser>(e, n);
+  }
+};
+
+/**
+ * @~english
+ * @brief Always the ratio of the first term. Truncates integral terms finer than the first one.
+ */
+struct LeftScale {
+  static constexpr size_t Choose(const detail::ScaleEntry*, size_t) noexcept { return 0; }
+};
+
+/**
+ * @~english
+ * @brief The exact common ratio that Unit::operator+ picks, computed over all terms at once.
+ */
+struct CommonScale {};
+
+namespace detail {
+
+template <typename U, typename... Rest>
+struct CommonOf {
+  using type = U;
+};
+
+template <typename U, typename V, typename... Rest>
+struct CommonOf<U, V, Rest...> {
+  using type = typename CommonOf<decltype(std::declval<U>() + std::declval<V>()), Rest...>::type;
+};
+
+template <typename... Us>
+struct ScaleEntries {
+  static constexpr ScaleEntry value[sizeof...(Us)] = {
+      {intmax_t(Us::scale::num), intmax_t(Us::scale::den), std::is_integral<typename Us::value_type>::value}...};
+};
+
+template <typename... Us>
+constexpr ScaleEntry ScaleEntries<Us...>::value[sizeof...(Us)];
+
+template <typename Policy, typename... Us>
+constexpr size_t ChooseScale() noexcept {
+  return Policy::Choose(ScaleEntries<Us...>::value, sizeof...(Us));
+}
+
+template <typename Policy, typename... Us>
+struct ScaleResult {
+  using type = typename std::tuple_element<ChooseScale<Policy, Us...>(), std::tuple<Us...>>::type;
+};
+
+template <typename... Us>
+struct ScaleResult<CommonScale, Us...> {
+  using type = typename CommonOf<Us...>::type;
+};
+
+template <typename R, typename U>
+constexpr typename R::value_type SumRescaled(const U& u) noexcept {
+  return Rescale<std::ratio_divide<typename U::scale, typename R::scale>>(u.GetValue());
+}
+
+template <typename R, typename U, typename... Rest>
+constexpr typename R::value_type SumRescaled(const U& u, const Rest&... rest) noexcept {
+  return Rescale<std::ratio_divide<typename U::scale, typename R::scale>>(u.GetValue()) + SumRescaled<R>(rest...);
+}
+
+constexpr bool AllOf() noexcept { return true; }
+
+template <typename... Rest>
+constexpr bool AllOf(bool first, Rest... rest) noexcept {
+  return first && AllOf(rest...);
+}
+
+constexpr size_t CountOf() noexcept { return 0; }
+
+template <typename... Rest>
+constexpr size_t CountOf(bool first, Rest... rest) noexcept {
+  return first + CountOf(rest...);
+}
+
+template <typename R, typename... Us>
+constexpr size_t CountRescales() noexcept {
+  return CountOf(!std::ratio_equal<typename Us::scale, typename R::scale>::value...);
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * @brief The result type of a sum of Us under Policy, and how many of the terms it rescales.
+ */
+template <typename Policy, typename U, typename... Us>
+struct ScaleChoice {
+  static_assert(detail::AllOf(std::is_same<typename U::template units<1, 1>, typename Us::template units<1, 1>>::value...),
+                "Only units of the same dimensions and value type can be summed.");
+
+  using type = typename detail::ScaleResult<Policy, U, Us...>::type;
+
+  /**
+   * @~english
+   * Number of terms whose ratio differs from the result's, i.e. runtime rescales.
+   */
+  static constexpr size_t rescales = detail::CountRescales<type, U, Us...>();
+};
+
+template <typename Policy, typename U, typename... Us>
+constexpr size_t ScaleChoice<Policy, U, Us...>::rescales;
+
+/**
+ * @~english
+ * Sums units in one step, with the result ratio chosen by the policy. Each term is rescaled at most once.
+ * @param terms The terms, of the same dimensions and value type in any ratios.
+ * @return The sum.
+ */
+template <typename Policy = CommonScale, typename U, typename... Us>
+constexpr typename ScaleChoice<Policy, U, Us...>::type ScaledSum(const U& term, const Us&... terms) noexcept {
+  using R = typename ScaleChoice<Policy, U, Us...>::type;
+  return R(detail::SumRescaled<R>(term, terms...));
+}
+
+/**
+ * @~english
+ * Subtracts two units, with the result ratio chosen by the policy.
+ */
+template <typename Policy = CommonScale, typename A, typename B>
+constexpr typename ScaleChoice<Policy, A, B>::type ScaledDifference(const A& a, const B& b) noexcept {
+  using R = typename ScaleChoice<Policy, A, B>::type;
+  return R(detail::SumRescaled<R>(a) - detail::SumRescaled<R>(b));
+}
+
+}  // namespace units
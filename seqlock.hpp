@@ -0,0 +1,107 @@
+#pragma once
+/**
+ * @~english
+ * @file seqlock.hpp
+ * @brief Sequence-lock publication of trivially copyable records, e.g. structs of unit fields.
+ *
+ * One writer publishes the latest record in a bounded number of steps and never waits. Readers copy the record and
+ * retry if a publish overlapped the copy, so they always see a complete record from a single Store(). The record is
+ * kept as relaxed atomic words, which makes the overlapping copies well defined, and the sequence sits at the start of
+ * the record's cache line so a small record costs readers a single line transfer per publish.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace units {
+
+/**
+ * @~english
+ * Assumed size of a cache line, in bytes.
+ */
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * @~english
+ * @brief Latest value of a trivially copyable record, published by a single writer to any number of readers.
+ */
+template <typename T>
+class alignas(kCacheLineSize) SeqLock {
+ public:
+  static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable records can be published.");
+
+  /**
+   * @~english
+   * Constructor
+   * @param value The initial record.
+   */
+  explicit SeqLock(const T& value = T()) noexcept : sequence_(0) {
+    uint64_t words[kWords] = {};
+    std::memcpy(words, &value, sizeof(T));
+    for (size_t i = 0; i < kWords; ++i) words_[i].store(words[i], std::memory_order_relaxed);
+  }
+
+  SeqLock(const SeqLock&) = delete;
+  SeqLock& operator=(const SeqLock&) = delete;
+
+  /**
+   * @~english
+   * Publishes a record. Wait-free. Only one thread may store at a time.
+   * @param value The record.
+   */
+  void Store(const T& value) noexcept {
+    uint64_t words[kWords] = {};
+    std::memcpy(words, &value, sizeof(T));
+    const uint64_t s = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kWords; ++i) words_[i].store(words[i], std::memory_order_relaxed);
+    sequence_.store(s + 2, std::memory_order_release);
+  }
+
+  /**
+   * @~english
+   * Reads the latest record, retrying while a Store() overlaps.
+   * @return The record.
+   */
+  T Load() const noexcept {
+    T value;
+    while (!TryLoad(&value)) {
+    }
+    return value;
+  }
+
+  /**
+   * @~english
+   * Reads the latest record once.
+   * @param value Receives the record on success.
+   * @return False if a Store() overlapped the read, in which case value is unchanged.
+   */
+  bool TryLoad(T* value) const noexcept {
+    const uint64_t before = sequence_.load(std::memory_order_acquire);
+    if (before & 1) return false;
+    uint64_t words[kWords];
+    for (size_t i = 0; i < kWords; ++i) words[i] = words_[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) != before) return false;
+    std::memcpy(value, words, sizeof(T));
+    return true;
+  }
+
+  /**
+   * @~english
+   * Gets the number of records stored since construction.
+   */
+  uint64_t Version() const noexcept { return sequence_.load(std::memory_order_acquire) / 2; }
+
+ private:
+  static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  std::atomic<uint64_t> sequence_;
+  std::atomic<uint64_t> words_[kWords];
+};
+
+}  // namespace units
@@ -0,0 +1,302 @@
+#pragma once
+/**
+ * @~english
+ * @file solve.hpp
+ * @brief Root finding and 1-D minimization with unit-typed brackets and tolerances.
+ *
+ * The scalar solvers take a function X -> Y of units. The batched solvers advance many independent problems in
+ * lockstep over structure-of-arrays state: every lane is updated with branch-free selects, converged lanes are masked
+ * out, and the loop ends once no lane is active. Their function is called as f(lane, x) so that it can look up
+ * per-problem parameters, and it is inlined into the lane loop.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief Result of a scalar solver.
+ */
+template <typename X>
+struct SolveResult {
+  X x;
+  size_t iterations;
+  bool converged;
+};
+
+namespace detail {
+
+template <typename U>
+inline bool SameSign(const U& a, const U& b) noexcept {
+  return (a.GetValue() < 0) == (b.GetValue() < 0);
+}
+
+/**
+ * @~english
+ * 1 / golden ratio.
+ */
+constexpr double kInverseGolden = 0.6180339887498948482;
+
+}  // namespace detail
+
+/**
+ * @~english
+ * Finds a root by bisection.
+ * @param f The function X -> Y.
+ * @param lo The lower end of the bracket.
+ * @param hi The upper end of the bracket, in any ratio of X. f(lo) and f(hi) must differ in sign.
+ * @param tol The bracket width at which to stop, in any ratio of X.
+ * @param max_iterations The iteration limit.
+ * @return The midpoint of the final bracket. Not converged, at lo, if f(lo) and f(hi) are non-zero of the same sign.
+ */
+template <typename X, typename H, typename F, typename T>
+SolveResult<X> Bisect(F f, X lo, const H& hi, const T& tol, size_t max_iterations = 200) {
+  using V = typename X::value_type;
+  const V eps = static_cast<X>(tol).GetValue();
+  V a = lo.GetValue(), b = static_cast<X>(hi).GetValue();
+  auto fa = f(lo);
+  const auto fb = f(X(b));
+  if (fa.GetValue() == 0) return {lo, 0, true};
+  if (fb.GetValue() == 0) return {X(b), 0, true};
+  if (detail::SameSign(fa, fb)) return {lo, 0, false};
+  for (size_t i = 0; i < max_iterations; ++i) {
+    const V m = a + (b - a) / 2;
+    if (std::fabs(b - a) <= eps) return {X(m), i, true};
+    const auto fm = f(X(m));
+    if (detail::SameSign(fm, fa)) {
+      a = m;
+      fa = fm;
+    } else {
+      b = m;
+    }
+  }
+  return {X(a + (b - a) / 2), max_iterations, false};
+}
+
+/**
+ * @~english
+ * Finds a root with Brent's method, combining bisection, secant and inverse quadratic interpolation steps.
+ * @param f The function X -> Y.
+ * @param lo The lower end of the bracket.
+ * @param hi The upper end of the bracket, in any ratio of X. f(lo) and f(hi) must differ in sign.
+ * @param tol The absolute tolerance on the root, in any ratio of X.
+ * @param max_iterations The iteration limit.
+ * @return The root. Not converged, at lo, if f(lo) and f(hi) are non-zero of the same sign.
+ */
+template <typename X, typename H, typename F, typename T>
+SolveResult<X> Brent(F f, X lo, const H& hi, const T& tol, size_t max_iterations = 100) {
+  using V = typename X::value_type;
+  const V eps = static_cast<X>(tol).GetValue();
+  V a = lo.GetValue(), b = static_cast<X>(hi).GetValue();
+  V fa = f(lo).GetValue(), fb = f(X(b)).GetValue();
+  if (fa != 0 && fb != 0 && (fa < 0) == (fb < 0)) return {lo, 0, false};
+  V c = a, fc = fa, d = b - a, e = d;
+  for (size_t i = 0; i < max_iterations; ++i) {
+    if ((fb > 0) == (fc > 0)) {
+      c = a;
+      fc = fa;
+      d = e = b - a;
+    }
+    if (std::fabs(fc) < std::fabs(fb)) {
+      a = b; b = c; c = a;
+      fa = fb; fb = fc; fc = fa;
+    }
+    const V m = (c - b) / 2;
+    const V t = 2 * std::numeric_limits<V>::epsilon() * std::fabs(b) + eps / 2;
+    if (std::fabs(m) <= t || fb == 0) return {X(b), i, true};
+    if (std::fabs(e) >= t && std::fabs(fa) > std::fabs(fb)) {
+      V p, q;
+      const V s = fb / fa;
+      if (a == c) {
+        p = 2 * m * s;
+        q = 1 - s;
+      } else {
+        const V r = fb / fc;
+        const V u = fa / fc;
+        p = s * (2 * m * u * (u - r) - (b - a) * (r - 1));
+        q = (u - 1) * (r - 1) * (s - 1);
+      }
+      if (p > 0) q = -q; else p = -p;
+      if (2 * p < std::fmin(3 * m * q - std::fabs(t * q), std::fabs(e * q))) {
+        e = d;
+        d = p / q;
+      } else {
+        d = e = m;
+      }
+    } else {
+      d = e = m;
+    }
+    a = b;
+    fa = fb;
+    b += std::fabs(d) > t ? d : (m > 0 ? t : -t);
+    fb = f(X(b)).GetValue();
+  }
+  return {X(b), max_iterations, false};
+}
+
+/**
+ * @~english
+ * Finds a root with Newton's method.
+ * @param f The function X -> Y.
+ * @param df The derivative X -> Y / X, in any ratio of Y / X.
+ * @param x0 The initial guess.
+ * @param tol The step size at which to stop, in any ratio of X.
+ * @param max_iterations The iteration limit.
+ * @return The root.
+ */
+template <typename X, typename F, typename DF, typename T>
+SolveResult<X> Newton(F f, DF df, X x0, const T& tol, size_t max_iterations = 50) {
+  using V = typename X::value_type;
+  using Y = decltype(f(x0));
+  using Slope = decltype(std::declval<Y>() / std::declval<X>());
+  const V eps = static_cast<X>(tol).GetValue();
+  V x = x0.GetValue();
+  for (size_t i = 0; i < max_iterations; ++i) {
+    const V step = f(X(x)).GetValue() / static_cast<Slope>(df(X(x))).GetValue();
+    x -= step;
+    if (std::fabs(step) <= eps) return {X(x), i + 1, true};
+  }
+  return {X(x), max_iterations, false};
+}
+
+/**
+ * @~english
+ * Minimizes a unimodal function by golden-section search.
+ * @param f The function X -> Y.
+ * @param lo The lower end of the bracket.
+ * @param hi The upper end of the bracket, in any ratio of X.
+ * @param tol The bracket width at which to stop, in any ratio of X.
+ * @param max_iterations The iteration limit.
+ * @return The minimizer.
+ */
+template <typename X, typename H, typename F, typename T>
+SolveResult<X> GoldenSection(F f, X lo, const H& hi, const T& tol, size_t max_iterations = 200) {
+  using V = typename X::value_type;
+  const V eps = static_cast<X>(tol).GetValue();
+  V a = lo.GetValue(), b = static_cast<X>(hi).GetValue();
+  V c = b - V(detail::kInverseGolden) * (b - a), d = a + V(detail::kInverseGolden) * (b - a);
+  auto fc = f(X(c)), fd = f(X(d));
+  for (size_t i = 0; i < max_iterations; ++i) {
+    if (std::fabs(b - a) <= eps) return {X(a + (b - a) / 2), i, true};
+    if (fc < fd) {
+      b = d; d = c; fd = fc;
+      c = b - V(detail::kInverseGolden) * (b - a);
+      fc = f(X(c));
+    } else {
+      a = c; c = d; fc = fd;
+      d = a + V(detail::kInverseGolden) * (b - a);
+      fd = f(X(d));
+    }
+  }
+  return {X(a + (b - a) / 2), max_iterations, false};
+}
+
+/**
+ * @~english
+ * Bisects many brackets in lockstep.
+ * @param f The function, called as f(lane, x) and returning a unit.
+ * @param lo The lower ends of the brackets, narrowed in place.
+ * @param hi The upper ends of the brackets, narrowed in place.
+ * @param n The number of problems.
+ * @param tol The bracket width at which a lane converges, in any ratio of X.
+ * @param max_iterations The iteration limit.
+ * @param bracketed Receives whether the ends of each lane differ in sign or one is a root. Lanes that are not
+ * bracketed are left unchanged. May be null.
+ * @return The number of iterations run.
+ */
+template <typename X, typename F, typename T>
+size_t BisectBatch(F f, X* lo, X* hi, size_t n, const T& tol, size_t max_iterations = 200, bool* bracketed = nullptr) {
+  using V = typename X::value_type;
+  const V eps = static_cast<X>(tol).GetValue();
+  std::vector<V> flo(n);
+  std::vector<bool> valid(n);
+  for (size_t i = 0; i < n; ++i) {
+    flo[i] = f(i, lo[i]).GetValue();
+    const V fhi = f(i, hi[i]).GetValue();
+    valid[i] = flo[i] == 0 || fhi == 0 || (flo[i] < 0) != (fhi < 0);
+    // A root at an end collapses the bracket onto it.
+    if (flo[i] == 0) hi[i] = lo[i];
+    if (flo[i] != 0 && fhi == 0) lo[i] = hi[i];
+    if (bracketed != nullptr) bracketed[i] = valid[i];
+  }
+  for (size_t iteration = 0; iteration < max_iterations; ++iteration) {
+    size_t active = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const V a = lo[i].GetValue(), b = hi[i].GetValue();
+      const V m = a + (b - a) / 2;
+      const V fm = f(i, X(m)).GetValue();
+      const bool live = valid[i] && std::fabs(b - a) > eps;
+      const bool left = (fm < 0) == (flo[i] < 0);
+      lo[i] = X(live && left ? m : a);
+      flo[i] = live && left ? fm : flo[i];
+      hi[i] = X(live && !left ? m : b);
+      active += live;
+    }
+    if (active == 0) return iteration;
+  }
+  return max_iterations;
+}
+
+/**
+ * @~english
+ * Runs golden-section minimizations of many unimodal functions in lockstep.
+ * @param f The function, called as f(lane, x) and returning a unit.
+ * @param lo The lower ends of the brackets.
+ * @param hi The upper ends of the brackets.
+ * @param n The number of problems.
+ * @param tol The bracket width at which a lane converges, in any ratio of X.
+ * @param out The minimizers.
+ * @param max_iterations The iteration limit.
+ * @return The number of iterations run.
+ */
+template <typename X, typename F, typename T>
+size_t GoldenSectionBatch(F f, const X* lo, const X* hi, size_t n, const T& tol, X* out,
+                          size_t max_iterations = 200) {
+  using V = typename X::value_type;
+  const V g = V(detail::kInverseGolden);
+  const V eps = static_cast<X>(tol).GetValue();
+  std::vector<V> a(n), b(n), c(n), d(n), fc(n), fd(n);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = lo[i].GetValue();
+    b[i] = hi[i].GetValue();
+    c[i] = b[i] - g * (b[i] - a[i]);
+    d[i] = a[i] + g * (b[i] - a[i]);
+    fc[i] = f(i, X(c[i])).GetValue();
+    fd[i] = f(i, X(d[i])).GetValue();
+  }
+  size_t iteration = 0;
+  for (; iteration < max_iterations; ++iteration) {
+    size_t active = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const bool live = std::fabs(b[i] - a[i]) > eps;
+      const bool left = fc[i] < fd[i];
+      const V na = left ? a[i] : c[i];
+      const V nb = left ? d[i] : b[i];
+      const V x = left ? nb - g * (nb - na) : na + g * (nb - na);
+      const V fx = f(i, X(x)).GetValue();
+      const V nc = left ? x : d[i], nfc = left ? fx : fd[i];
+      const V nd = left ? c[i] : x, nfd = left ? fc[i] : fx;
+      a[i] = live ? na : a[i];
+      b[i] = live ? nb : b[i];
+      c[i] = live ? nc : c[i];
+      d[i] = live ? nd : d[i];
+      fc[i] = live ? nfc : fc[i];
+      fd[i] = live ? nfd : fd[i];
+      active += live;
+    }
+    if (active == 0) break;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = X(a[i] + (b[i] - a[i]) / 2);
+  }
+  return iteration;
+}
+
+}  // namespace units
@@ -0,0 +1,227 @@
+#pragma once
+/**
+ * @~english
+ * @file sort.hpp
+ * @brief Parallel LSD radix sort and argsort of unit arrays.
+ *
+ * Values are mapped to unsigned keys that order like the values: signed integers flip the sign bit, and floating point
+ * values flip the sign bit of positives and all bits of negatives. Keys are sorted by 8-bit digits, least significant
+ * first. Each pass builds per-thread histograms and every thread scatters its own chunk, which keeps the sort stable.
+ * Passes in which every key has the same digit are skipped.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "parallel.hpp"
+#include "unit.hpp"
+
+namespace units {
+namespace detail {
+
+/**
+ * @~english
+ * Unsigned key type with the width of T.
+ */
+template <typename T>
+using RadixKey = typename std::conditional<sizeof(T) <= 4, uint32_t, uint64_t>::type;
+
+/**
+ * @~english
+ * Maps a value to an unsigned key with the same order.
+ */
+template <typename T>
+RadixKey<T> ToRadixKey(T value) noexcept {
+  static_assert(sizeof(T) <= 8, "Keys wider than 64 bits are not supported.");
+  using K = RadixKey<T>;
+  constexpr K kSign = K(1) << (sizeof(K) * 8 - 1);
+  if (std::is_floating_point<T>::value) {
+    K bits = 0;
+    std::memcpy(&bits, &value, sizeof(T));
+    return bits ^ ((bits & kSign) ? ~K(0) : kSign);
+  }
+  const K bits = static_cast<K>(value);
+  return std::is_signed<T>::value ? bits ^ kSign : bits;
+}
+
+/**
+ * @~english
+ * Inverse of ToRadixKey.
+ */
+template <typename T>
+T FromRadixKey(RadixKey<T> key) noexcept {
+  using K = RadixKey<T>;
+  constexpr K kSign = K(1) << (sizeof(K) * 8 - 1);
+  if (std::is_floating_point<T>::value) {
+    const K bits = key ^ ((key & kSign) ? kSign : ~K(0));
+    T value;
+    std::memcpy(&value, &bits, sizeof(T));
+    return value;
+  }
+  return static_cast<T>(std::is_signed<T>::value ? key ^ kSign : key);
+}
+
+/**
+ * @~english
+ * Number of elements below which the sort runs on one thread.
+ */
+constexpr size_t kRadixParallelThreshold = 1 << 16;
+
+/**
+ * @~english
+ * Sorts unsigned keys, and an optional payload (may be null) alongside them.
+ * @param keys The keys, sorted in place.
+ * @param payload The payload permuted with the keys, or null.
+ * @param n The number of keys.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ */
+template <typename K, typename P>
+void RadixSortKeys(K* keys, P* payload, size_t n, unsigned threads) {
+  constexpr size_t kRadix = 256;
+  const unsigned tasks = n < kRadixParallelThreshold ? 1u : ThreadCount(threads);
+  const size_t chunk = (n + tasks - 1) / tasks;
+  std::vector<K> key_buffer(n);
+  std::vector<P> payload_buffer(payload != nullptr ? n : 0);
+  K* src = keys;
+  K* dst = key_buffer.data();
+  P* psrc = payload;
+  P* pdst = payload_buffer.data();
+  std::vector<size_t> counts(tasks * kRadix);
+
+  for (size_t shift = 0; shift < sizeof(K) * 8; shift += 8) {
+    std::fill(counts.begin(), counts.end(), 0);
+    ParallelTasks(tasks, [&](unsigned t) {
+      size_t* count = &counts[t * kRadix];
+      const size_t end = std::min(n, (t + 1) * chunk);
+      for (size_t i = t * chunk; i < end; ++i) {
+        ++count[(src[i] >> shift) & 0xff];
+      }
+    });
+
+    bool trivial = false;
+    size_t offset = 0;
+    for (size_t digit = 0; digit < kRadix; ++digit) {
+      size_t total = 0;
+      for (unsigned t = 0; t < tasks; ++t) {
+        const size_t c = counts[t * kRadix + digit];
+        counts[t * kRadix + digit] = offset + total;
+        total += c;
+      }
+      trivial = trivial || total == n;
+      offset += total;
+    }
+    if (trivial) {
+      continue;
+    }
+
+    ParallelTasks(tasks, [&](unsigned t) {
+      size_t* next = &counts[t * kRadix];
+      const size_t end = std::min(n, (t + 1) * chunk);
+      for (size_t i = t * chunk; i < end; ++i) {
+        const size_t to = next[(src[i] >> shift) & 0xff]++;
+        dst[to] = src[i];
+        if (psrc != nullptr) {
+          pdst[to] = psrc[i];
+        }
+      }
+    });
+    std::swap(src, dst);
+    std::swap(psrc, pdst);
+  }
+
+  if (src != keys) {
+    std::copy(src, src + n, keys);
+    if (payload != nullptr) {
+      std::copy(psrc, psrc + n, payload);
+    }
+  }
+}
+
+/**
+ * @~english
+ * Gathers column[order[i]] into column[i].
+ */
+template <typename C>
+void Permute(C* column, const size_t* order, size_t n) {
+  std::vector<C> sorted(n);
+  for (size_t i = 0; i < n; ++i) {
+    sorted[i] = column[order[i]];
+  }
+  std::copy(sorted.begin(), sorted.end(), column);
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * Sorts units in ascending order. Supports integral and floating point value types.
+ * @param data The units, sorted in place.
+ * @param n The number of units.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ */
+template <typename U>
+void RadixSort(U* data, size_t n, unsigned threads = 0) {
+  using T = typename U::value_type;
+  using K = detail::RadixKey<T>;
+  static_assert(std::is_arithmetic<T>::value, "Radix sort requires an arithmetic value type.");
+  std::vector<K> keys(n);
+  for (size_t i = 0; i < n; ++i) {
+    keys[i] = detail::ToRadixKey(data[i].GetValue());
+  }
+  detail::RadixSortKeys(keys.data(), static_cast<size_t*>(nullptr), n, threads);
+  for (size_t i = 0; i < n; ++i) {
+    data[i] = U(detail::FromRadixKey<T>(keys[i]));
+  }
+}
+
+/**
+ * @~english
+ * Computes the stable sorting permutation of units.
+ * @param keys The units to order.
+ * @param n The number of units.
+ * @param order Receives n indices such that keys[order[i]] is ascending.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ */
+template <typename U>
+void RadixArgsort(const U* keys, size_t n, size_t* order, unsigned threads = 0) {
+  using T = typename U::value_type;
+  using K = detail::RadixKey<T>;
+  static_assert(std::is_arithmetic<T>::value, "Radix sort requires an arithmetic value type.");
+  std::vector<K> transformed(n);
+  for (size_t i = 0; i < n; ++i) {
+    transformed[i] = detail::ToRadixKey(keys[i].GetValue());
+  }
+  std::iota(order, order + n, size_t(0));
+  detail::RadixSortKeys(transformed.data(), order, n, threads);
+}
+
+/**
+ * @~english
+ * Sorts units and reorders any number of companion columns the same way. The permutation is carried through the radix
+ * passes and every companion column is gathered once, the columns spread over at most threads threads.
+ * @param keys The units, sorted in place.
+ * @param n The number of rows.
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ * @param columns Companion columns of n elements each.
+ */
+template <typename U, typename... Columns>
+void RadixSortByKey(U* keys, size_t n, unsigned threads, Columns*... columns) {
+  std::vector<size_t> order(n);
+  RadixArgsort(keys, n, order.data(), threads);
+  detail::Permute(keys, order.data(), n);
+  const unsigned tasks = static_cast<unsigned>(std::min<size_t>(detail::ThreadCount(threads), sizeof...(Columns)));
+  detail::ParallelTasks(tasks, [&](unsigned t) {
+    // Task t gathers columns t, t + tasks, ...
+    size_t c = 0;
+    int expand[] = {0, ((c++ % tasks == t ? detail::Permute(columns, order.data(), n) : void()), 0)...};
+    (void)expand;
+    (void)c;
+  });
+}
+
+}  // namespace units
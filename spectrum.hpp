@@ -0,0 +1,416 @@
+#pragma once
+/**
+ * @~english
+ * @file spectrum.hpp
+ * @brief Real FFTs, periodograms and Welch power spectral densities of sampled unit signals.
+ *
+ * Transforms run on cached plans. Power-of-two lengths use an iterative radix-2 transform over separate real and
+ * imaginary arrays with per-stage contiguous twiddles, so every butterfly loop vectorizes. Other lengths go through
+ * Bluestein's algorithm on a power-of-two plan. A real signal of even length is packed into a complex transform of
+ * half the length.
+ *
+ * Bins are typed: frequencies are Hertz (inverse seconds) and a signal in units U has a density in U^2 / Hertz.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * Frequency in cycles per second.
+ */
+template <typename T>
+using Hertz = Unit<T, -1, 0, 0, 0, 0, 0, 0, 1, 1>;
+
+/**
+ * @~english
+ * Power spectral density of a signal in units U, i.e. U^2 / Hertz.
+ */
+template <typename U>
+using SpectralDensity = decltype(std::declval<U>() * std::declval<U>() /
+                                 std::declval<Hertz<typename U::value_type>>());
+
+namespace detail {
+
+/**
+ * @~english
+ * Returns the plan of the given size from a process-wide cache, building it on first use. Plans are built outside the
+ * lock since building one may fetch another; if two threads race, the first plan inserted wins.
+ */
+template <typename Plan>
+std::shared_ptr<const Plan> CachedPlan(size_t n) {
+  static std::mutex mutex;
+  static std::map<size_t, std::shared_ptr<const Plan>> plans;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = plans.find(n);
+    if (it != plans.end()) return it->second;
+  }
+  auto plan = std::make_shared<const Plan>(n);
+  std::lock_guard<std::mutex> lock(mutex);
+  return plans.emplace(n, std::move(plan)).first->second;
+}
+
+template <typename T>
+T Pi() noexcept {
+  return T(3.14159265358979323846264338327950288L);
+}
+
+}  // namespace detail
+
+/**
+ * @~english
+ * @brief Plan for forward complex transforms of one length.
+ */
+template <typename T>
+class FftPlan {
+ public:
+  static_assert(std::is_floating_point<T>::value, "Only floating point transforms supported.");
+
+  /**
+   * @~english
+   * Builds a plan. Prefer Get(), which caches plans.
+   * @param n The transform length. A plan of length zero transforms nothing.
+   */
+  explicit FftPlan(size_t n) : n_(n) {
+    if (n == 0) return;
+    size_t m = 1;
+    while (m < n) m *= 2;
+    if (m == n) {
+      BuildRadix2();
+      return;
+    }
+    while (m < 2 * n - 1) m *= 2;
+    inner_ = Get(m);
+    chirp_re_.resize(n);
+    chirp_im_.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+      // k^2 mod 2n keeps the angle small and exact.
+      const T angle = detail::Pi<T>() * T((k * k) % (2 * n)) / T(n);
+      chirp_re_[k] = std::cos(angle);
+      chirp_im_[k] = -std::sin(angle);
+    }
+    filter_re_.assign(m, T(0));
+    filter_im_.assign(m, T(0));
+    for (size_t k = 0; k < n; ++k) {
+      filter_re_[k] = chirp_re_[k];
+      filter_im_[k] = -chirp_im_[k];
+      if (k > 0) {
+        filter_re_[m - k] = chirp_re_[k];
+        filter_im_[m - k] = -chirp_im_[k];
+      }
+    }
+    inner_->Forward(filter_re_.data(), filter_im_.data());
+  }
+
+  /**
+   * @~english
+   * Gets the cached plan of the given length.
+   * @param n The transform length.
+   * @return The shared plan. Safe to use from several threads.
+   */
+  static std::shared_ptr<const FftPlan> Get(size_t n) { return detail::CachedPlan<FftPlan>(n); }
+
+  size_t Size() const noexcept { return n_; }
+
+  /**
+   * @~english
+   * Computes the unnormalized forward transform X[k] = sum x[j] exp(-2 pi i j k / n) in place.
+   * @param re The real parts.
+   * @param im The imaginary parts.
+   */
+  void Forward(T* re, T* im) const {
+    if (inner_) {
+      Bluestein(re, im);
+      return;
+    }
+    for (size_t i = 0; i < n_; ++i) {
+      const size_t j = reverse_[i];
+      if (i < j) {
+        std::swap(re[i], re[j]);
+        std::swap(im[i], im[j]);
+      }
+    }
+    for (size_t half = 1; half < n_; half *= 2) {
+      const T* wr = &twiddle_re_[half - 1];
+      const T* wi = &twiddle_im_[half - 1];
+      for (size_t block = 0; block < n_; block += 2 * half) {
+        T* ar = re + block;
+        T* ai = im + block;
+        T* br = ar + half;
+        T* bi = ai + half;
+        for (size_t j = 0; j < half; ++j) {
+          const T tr = br[j] * wr[j] - bi[j] * wi[j];
+          const T ti = br[j] * wi[j] + bi[j] * wr[j];
+          br[j] = ar[j] - tr;
+          bi[j] = ai[j] - ti;
+          ar[j] += tr;
+          ai[j] += ti;
+        }
+      }
+    }
+  }
+
+ private:
+  void BuildRadix2() {
+    size_t bits = 0;
+    while ((size_t(1) << bits) < n_) ++bits;
+    reverse_.resize(n_);
+    for (size_t i = 0; i < n_; ++i) {
+      size_t r = 0;
+      for (size_t b = 0; b < bits; ++b) r |= ((i >> b) & 1) << (bits - 1 - b);
+      reverse_[i] = r;
+    }
+    // The twiddles of the stage with butterflies of span `half` start at half - 1.
+    twiddle_re_.resize(n_ > 1 ? n_ - 1 : 0);
+    twiddle_im_.resize(twiddle_re_.size());
+    for (size_t half = 1; half < n_; half *= 2) {
+      for (size_t j = 0; j < half; ++j) {
+        const T angle = detail::Pi<T>() * T(j) / T(half);
+        twiddle_re_[half - 1 + j] = std::cos(angle);
+        twiddle_im_[half - 1 + j] = -std::sin(angle);
+      }
+    }
+  }
+
+  void Bluestein(T* re, T* im) const {
+    const size_t m = inner_->Size();
+    std::vector<T> ar(m, T(0)), ai(m, T(0));
+    for (size_t k = 0; k < n_; ++k) {
+      ar[k] = re[k] * chirp_re_[k] - im[k] * chirp_im_[k];
+      ai[k] = re[k] * chirp_im_[k] + im[k] * chirp_re_[k];
+    }
+    inner_->Forward(ar.data(), ai.data());
+    // Multiply by the filter and conjugate, so that a forward transform computes the conjugated inverse.
+    for (size_t k = 0; k < m; ++k) {
+      const T r = ar[k] * filter_re_[k] - ai[k] * filter_im_[k];
+      const T i = ar[k] * filter_im_[k] + ai[k] * filter_re_[k];
+      ar[k] = r;
+      ai[k] = -i;
+    }
+    inner_->Forward(ar.data(), ai.data());
+    const T scale = T(1) / T(m);
+    for (size_t k = 0; k < n_; ++k) {
+      const T cr = ar[k] * scale, ci = -ai[k] * scale;
+      re[k] = cr * chirp_re_[k] - ci * chirp_im_[k];
+      im[k] = cr * chirp_im_[k] + ci * chirp_re_[k];
+    }
+  }
+
+  size_t n_;
+  std::vector<size_t> reverse_;
+  std::vector<T> twiddle_re_;
+  std::vector<T> twiddle_im_;
+  std::shared_ptr<const FftPlan> inner_;
+  std::vector<T> chirp_re_;
+  std::vector<T> chirp_im_;
+  std::vector<T> filter_re_;
+  std::vector<T> filter_im_;
+};
+
+/**
+ * @~english
+ * @brief Plan for forward transforms of real signals of one length.
+ */
+template <typename T>
+class RealFftPlan {
+ public:
+  /**
+   * @~english
+   * Builds a plan. Prefer Get(), which caches plans.
+   * @param n The signal length. A plan of length zero has no bins.
+   */
+  explicit RealFftPlan(size_t n) : n_(n), complex_(FftPlan<T>::Get(n % 2 == 0 ? n / 2 : n)) {
+    if (n % 2 != 0) return;
+    post_re_.resize(n / 2 + 1);
+    post_im_.resize(n / 2 + 1);
+    for (size_t k = 0; k <= n / 2; ++k) {
+      const T angle = 2 * detail::Pi<T>() * T(k) / T(n);
+      post_re_[k] = std::cos(angle);
+      post_im_[k] = -std::sin(angle);
+    }
+  }
+
+  /**
+   * @~english
+   * Gets the cached plan of the given length.
+   * @param n The signal length.
+   * @return The shared plan. Safe to use from several threads.
+   */
+  static std::shared_ptr<const RealFftPlan> Get(size_t n) { return detail::CachedPlan<RealFftPlan>(n); }
+
+  size_t Size() const noexcept { return n_; }
+
+  /**
+   * @~english
+   * Number of non-redundant output bins, n / 2 + 1, or zero for an empty signal.
+   */
+  size_t Bins() const noexcept { return n_ == 0 ? 0 : n_ / 2 + 1; }
+
+  /**
+   * @~english
+   * Computes the non-negative frequency half of the unnormalized forward transform.
+   * @param in The n samples.
+   * @param re The Bins() real parts.
+   * @param im The Bins() imaginary parts.
+   */
+  void Forward(const T* in, T* re, T* im) const {
+    if (n_ == 0) return;
+    if (n_ % 2 != 0) {
+      std::vector<T> zr(in, in + n_), zi(n_, T(0));
+      complex_->Forward(zr.data(), zi.data());
+      std::copy(zr.begin(), zr.begin() + Bins(), re);
+      std::copy(zi.begin(), zi.begin() + Bins(), im);
+      return;
+    }
+    const size_t h = n_ / 2;
+    std::vector<T> zr(h), zi(h);
+    for (size_t k = 0; k < h; ++k) {
+      zr[k] = in[2 * k];
+      zi[k] = in[2 * k + 1];
+    }
+    complex_->Forward(zr.data(), zi.data());
+    // X[k] = E[k] + W^k O[k], where E and O are the transforms of the even and odd samples recovered from Z.
+    for (size_t k = 0; k <= h; ++k) {
+      const T ar = zr[k % h], ai = zi[k % h];
+      const T br = zr[(h - k) % h], bi = -zi[(h - k) % h];
+      const T er = (ar + br) / 2, ei = (ai + bi) / 2;
+      const T orr = (ai - bi) / 2, oi = (br - ar) / 2;
+      re[k] = er + orr * post_re_[k] - oi * post_im_[k];
+      im[k] = ei + orr * post_im_[k] + oi * post_re_[k];
+    }
+  }
+
+ private:
+  size_t n_;
+  std::shared_ptr<const FftPlan<T>> complex_;
+  std::vector<T> post_re_;
+  std::vector<T> post_im_;
+};
+
+/**
+ * @~english
+ * Computes the non-negative frequency half of the transform of a real signal.
+ * @param signal The n samples.
+ * @param n The number of samples.
+ * @param re The n / 2 + 1 real parts, in the units of the signal.
+ * @param im The n / 2 + 1 imaginary parts, in the units of the signal.
+ */
+template <typename U>
+void RealFft(const U* signal, size_t n, U* re, U* im) {
+  using T = typename U::value_type;
+  const auto plan = RealFftPlan<T>::Get(n);
+  std::vector<T> x(n), xr(plan->Bins()), xi(plan->Bins());
+  for (size_t i = 0; i < n; ++i) x[i] = signal[i].GetValue();
+  plan->Forward(x.data(), xr.data(), xi.data());
+  for (size_t k = 0; k < plan->Bins(); ++k) {
+    re[k] = U(xr[k]);
+    im[k] = U(xi[k]);
+  }
+}
+
+/**
+ * @~english
+ * Computes the bin frequencies of a one-sided spectrum.
+ * @param n The transform length.
+ * @param interval The sample interval, in any time unit.
+ * @param out The n / 2 + 1 frequencies k / (n interval), or none if n is zero.
+ */
+template <typename T, typename Dt>
+void Frequencies(size_t n, const Dt& interval, Hertz<T>* out) {
+  if (n == 0) return;
+  const T dt = static_cast<Unit<T, 1, 0, 0, 0, 0, 0, 0>>(interval).GetValue();
+  for (size_t k = 0; k <= n / 2; ++k) {
+    out[k] = Hertz<T>(T(k) / (T(n) * dt));
+  }
+}
+
+/**
+ * @~english
+ * Estimates the one-sided power spectral density with Welch's method: the signal is cut into overlapping segments,
+ * each segment has its mean removed and is weighted by a periodic Hann window, and the periodograms are averaged.
+ * Segments are split across threads, each accumulating its own partial sum; the partial sums are combined in a fixed
+ * order, so the result does not depend on scheduling.
+ * @param signal The samples.
+ * @param n The number of samples.
+ * @param interval The sample interval, in any time unit.
+ * @param segment The segment length, at least one. A segment of one sample is not windowed. Cached plans make repeated
+ * calls with one segment length cheap.
+ * @param overlap The number of samples shared by consecutive segments, less than segment.
+ * @param psd The segment / 2 + 1 density estimates, at the frequencies given by Frequencies(segment, interval).
+ * @param threads The number of threads. Zero uses the hardware concurrency.
+ * @return The number of segments averaged. Zero, with psd left untouched, if segment is zero or overlap is not less
+ * than segment.
+ */
+template <typename U, typename Dt>
+size_t Welch(const U* signal, size_t n, const Dt& interval, size_t segment, size_t overlap, SpectralDensity<U>* psd,
+             unsigned threads = 0) {
+  using T = typename U::value_type;
+  if (segment == 0 || overlap >= segment) return 0;
+  const auto plan = RealFftPlan<T>::Get(segment);
+  const size_t bins = plan->Bins();
+  const size_t step = segment - overlap;
+  const size_t segments = n < segment ? 0 : (n - segment) / step + 1;
+  std::vector<T> window(segment);
+  T power = 0;
+  for (size_t i = 0; i < segment; ++i) {
+    // The periodic Hann window of one sample is zero, which would leave no power to normalize by.
+    window[i] = segment == 1 ? T(1) : T(0.5) - T(0.5) * std::cos(2 * detail::Pi<T>() * T(i) / T(segment));
+    power += window[i] * window[i];
+  }
+
+  const unsigned tasks = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(detail::ThreadCount(threads),
+                                                                                     segments)));
+  std::vector<std::vector<T>> partial(tasks, std::vector<T>(bins, T(0)));
+  detail::ParallelTasks(tasks, [&](unsigned t) {
+    std::vector<T> x(segment), re(bins), im(bins);
+    T* sum = partial[t].data();
+    for (size_t s = segments * t / tasks; s < segments * (t + 1) / tasks; ++s) {
+      const U* in = signal + s * step;
+      T mean = 0;
+      for (size_t i = 0; i < segment; ++i) mean += in[i].GetValue();
+      mean /= T(segment);
+      for (size_t i = 0; i < segment; ++i) x[i] = (in[i].GetValue() - mean) * window[i];
+      plan->Forward(x.data(), re.data(), im.data());
+      for (size_t k = 0; k < bins; ++k) sum[k] += re[k] * re[k] + im[k] * im[k];
+    }
+  });
+
+  // Density: |X|^2 dt / sum(w^2), doubled for every bin that has a negative frequency twin.
+  const T dt = static_cast<Unit<T, 1, 0, 0, 0, 0, 0, 0>>(interval).GetValue();
+  const T scale = segments > 0 ? dt / (power * T(segments)) : T(0);
+  for (size_t k = 0; k < bins; ++k) {
+    T total = 0;
+    for (unsigned t = 0; t < tasks; ++t) total += partial[t][k];
+    const bool twin = k > 0 && !(segment % 2 == 0 && k == segment / 2);
+    psd[k] = SpectralDensity<U>(total * scale * (twin ? T(2) : T(1)));
+  }
+  return segments;
+}
+
+/**
+ * @~english
+ * Estimates the one-sided power spectral density from a single Hann-windowed segment spanning the whole signal.
+ * @param signal The samples.
+ * @param n The number of samples.
+ * @param interval The sample interval, in any time unit.
+ * @param psd The n / 2 + 1 density estimates.
+ */
+template <typename U, typename Dt>
+void Periodogram(const U* signal, size_t n, const Dt& interval, SpectralDensity<U>* psd) {
+  Welch(signal, n, interval, n, 0, psd, 1);
+}
+
+}  // namespace units
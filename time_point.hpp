@@ -0,0 +1,242 @@
+#pragma once
+/**
+ * @~english
+ * @file time_point.hpp
+ * @brief Absolute time points relative to an epoch, with exact epoch and ratio conversions.
+ *
+ * A TimePoint is affine: the difference of two points is a duration and a point plus a duration is a point, but two
+ * points cannot be added. An epoch is a type whose offset is the exact number of seconds from the UNIX epoch to it, as
+ * a std::ratio. Moving a point to another epoch and duration ratio is v * s + o with both s and o folded at compile
+ * time, so converting arrays costs one multiply-add (or an integer multiply, divide and add) per element.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <type_traits>
+
+#include "unit.hpp"
+
+namespace units {
+
+/**
+ * @~english
+ * @brief 1970-01-01T00:00:00 UTC.
+ */
+struct UnixEpoch {
+  using offset = std::ratio<0>;
+};
+
+/**
+ * @~english
+ * @brief 1980-01-06T00:00:00 UTC, the start of GPS time. Leap seconds are not applied.
+ */
+struct GpsEpoch {
+  using offset = std::ratio<315964800>;
+};
+
+/**
+ * @~english
+ * @brief 1900-01-01T00:00:00 UTC, the NTP prime epoch.
+ */
+struct NtpEpoch {
+  using offset = std::ratio<-2208988800LL>;
+};
+
+/**
+ * @~english
+ * @brief Epoch of a std::chrono clock. Specialize it for clocks other than std::chrono::system_clock.
+ */
+template <typename Clock>
+struct ClockEpoch;
+
+template <>
+struct ClockEpoch<std::chrono::system_clock> {
+  using type = UnixEpoch;
+};
+
+/**
+ * @~english
+ * The Unit matching a std::chrono::duration, e.g. std::chrono::milliseconds maps to i::Millisecond.
+ */
+template <typename Duration>
+using ChronoUnit = Unit<typename Duration::rep, 1, 0, 0, 0, 0, 0, 0, Duration::period::num, Duration::period::den>;
+
+/**
+ * @~english
+ * Converts a std::chrono::duration into the matching Unit.
+ */
+template <typename Rep, typename Period>
+constexpr ChronoUnit<std::chrono::duration<Rep, Period>> FromChrono(const std::chrono::duration<Rep, Period>& d) {
+  return ChronoUnit<std::chrono::duration<Rep, Period>>(d.count());
+}
+
+/**
+ * @~english
+ * Converts a time Unit into the matching std::chrono::duration.
+ */
+template <typename U>
+constexpr std::chrono::duration<typename U::value_type, typename U::scale> ToChrono(const U& u) {
+  static_assert(std::is_same<typename U::template units<1, 1>, Unit<typename U::value_type, 1, 0, 0, 0, 0, 0, 0>>::value,
+                "Only time units convert to std::chrono durations.");
+  return std::chrono::duration<typename U::value_type, typename U::scale>(u.GetValue());
+}
+
+namespace detail {
+
+/**
+ * @~english
+ * The affine map taking a value of D1 since E1 to a value of D2 since E2: v2 = v1 * scale + offset.
+ */
+template <typename D1, typename E1, typename D2, typename E2>
+struct EpochShift {
+  using scale = std::ratio_divide<typename D1::scale, typename D2::scale>;
+  using offset = std::ratio_divide<std::ratio_subtract<typename E1::offset, typename E2::offset>, typename D2::scale>;
+
+  // Common denominator of scale and offset, so that integers are shifted by one exact sum truncated once.
+  static constexpr intmax_t den = lcm(scale::den, offset::den);
+
+  template <typename W>
+  static constexpr W Apply(W v, std::true_type) noexcept {
+    return v * (W(scale::num) / W(scale::den)) + W(offset::num) / W(offset::den);
+  }
+
+  template <typename W>
+  static constexpr W Apply(W v, std::false_type) noexcept {
+    return (W(scale::num * (den / scale::den)) * v + W(offset::num * (den / offset::den))) / W(den);
+  }
+
+  /**
+   * @~english
+   * Maps v into T, working in the common type of the source and target values so that a floating point source keeps
+   * its fraction until the single final cast.
+   */
+  template <typename T, typename S>
+  static constexpr T Apply(S v) noexcept {
+    using W = typename std::common_type<S, T>::type;
+    return T(Apply(W(v), std::is_floating_point<W>()));
+  }
+};
+
+template <typename D1, typename E1, typename D2, typename E2>
+constexpr intmax_t EpochShift<D1, E1, D2, E2>::den;
+
+}  // namespace detail
+
+/**
+ * @~english
+ * @brief Point in time measured as a duration D since Epoch.
+ */
+template <typename D, typename Epoch = UnixEpoch>
+class TimePoint {
+ public:
+  static_assert(std::is_same<typename D::template units<1, 1>,
+                             Unit<typename D::value_type, 1, 0, 0, 0, 0, 0, 0>>::value,
+                "A time point is measured in time units.");
+
+  using duration = D;
+  using epoch = Epoch;
+  using value_type = typename D::value_type;
+
+  TimePoint() = default;
+
+  /**
+   * @~english
+   * Constructor
+   * @param since_epoch The time since the epoch, in any ratio of D.
+   */
+  template <typename U>
+  constexpr explicit TimePoint(const U& since_epoch) : since_epoch_(static_cast<D>(since_epoch)) {}
+
+  /**
+   * @~english
+   * Converts from another epoch or duration ratio. Integer targets truncate the shifted value like Unit conversions.
+   */
+  template <typename D2, typename E2>
+  constexpr TimePoint(const TimePoint<D2, E2>& other)
+      : since_epoch_(detail::EpochShift<D2, E2, D, Epoch>::template Apply<value_type>(other.SinceEpoch().GetValue())) {}
+
+  /**
+   * @~english
+   * Converts from a std::chrono::time_point of a clock with a known ClockEpoch.
+   */
+  template <typename Clock, typename Duration>
+  constexpr TimePoint(const std::chrono::time_point<Clock, Duration>& t)
+      : TimePoint(TimePoint<ChronoUnit<Duration>, typename ClockEpoch<Clock>::type>(FromChrono(t.time_since_epoch()))) {}
+
+  /**
+   * @~english
+   * Gets the time since the epoch.
+   */
+  constexpr D SinceEpoch() const noexcept { return since_epoch_; }
+
+  /**
+   * @~english
+   * Converts into a std::chrono::time_point of the given clock, in the duration ratio of this point.
+   */
+  template <typename Clock>
+  std::chrono::time_point<Clock, std::chrono::duration<value_type, typename D::scale>> ToChrono() const {
+    const TimePoint<D, typename ClockEpoch<Clock>::type> t(*this);
+    return std::chrono::time_point<Clock, std::chrono::duration<value_type, typename D::scale>>(
+        units::ToChrono(t.SinceEpoch()));
+  }
+
+  /**
+   * @~english
+   * Shifts the point by a duration in any time ratio, converted into D.
+   */
+  template <typename U>
+  constexpr TimePoint operator+(const U& d) const {
+    return TimePoint(D(since_epoch_.GetValue() + static_cast<D>(d).GetValue()));
+  }
+
+  template <typename U>
+  constexpr TimePoint operator-(const U& d) const {
+    return TimePoint(D(since_epoch_.GetValue() - static_cast<D>(d).GetValue()));
+  }
+
+  /**
+   * @~english
+   * Gets the duration between two points. The other point is first moved to this epoch and ratio.
+   */
+  template <typename D2, typename E2>
+  constexpr D operator-(const TimePoint<D2, E2>& other) const {
+    return D(since_epoch_.GetValue() - TimePoint(other).SinceEpoch().GetValue());
+  }
+
+  template <typename D2>
+  bool operator==(const TimePoint<D2, Epoch>& other) const noexcept { return since_epoch_ == other.SinceEpoch(); }
+  template <typename D2>
+  bool operator!=(const TimePoint<D2, Epoch>& other) const noexcept { return since_epoch_ != other.SinceEpoch(); }
+  template <typename D2>
+  bool operator<(const TimePoint<D2, Epoch>& other) const noexcept { return since_epoch_ < other.SinceEpoch(); }
+  template <typename D2>
+  bool operator>(const TimePoint<D2, Epoch>& other) const noexcept { return since_epoch_ > other.SinceEpoch(); }
+  template <typename D2>
+  bool operator<=(const TimePoint<D2, Epoch>& other) const noexcept { return since_epoch_ <= other.SinceEpoch(); }
+  template <typename D2>
+  bool operator>=(const TimePoint<D2, Epoch>& other) const noexcept { return since_epoch_ >= other.SinceEpoch(); }
+
+ private:
+  D since_epoch_;
+};
+
+/**
+ * @~english
+ * Moves an array of time points to another epoch and duration ratio. The scale and offset are compile-time constants,
+ * so floating point points cost one multiply-add each.
+ * @param in The points.
+ * @param out The converted points. May alias in if the types have the same size.
+ * @param n The number of points.
+ */
+template <typename To, typename From>
+void ConvertEpoch(const From* in, To* out, size_t n) noexcept {
+  using T = typename To::value_type;
+  using s = detail::EpochShift<typename From::duration, typename From::epoch, typename To::duration, typename To::epoch>;
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = To(typename To::duration(s::template Apply<T>(in[i].SinceEpoch().GetValue())));
+  }
+}
+
+}  // namespace units
@@ -1,12 +1,121 @@
 #define CATCH_CONFIG_MAIN
 #include "test/catch.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "aggregate.hpp"
+#include "constants.hpp"
+#include "decibel.hpp"
+#include "dual.hpp"
+#include "export.hpp"
+#include "fixed_buffer.hpp"
+#include "formula.hpp"
+#include "interval.hpp"
+#include "interval_index.hpp"
+#include "join.hpp"
+#include "kdtree.hpp"
+#include "measurement.hpp"
+#include "nonsi.hpp"
+#include "polynomial.hpp"
+#include "prefix.hpp"
+#include "random.hpp"
+#include "range_check.hpp"
+#include "registry.hpp"
+#include "rotation.hpp"
+#include "scale_policy.hpp"
+#include "seqlock.hpp"
+#include "solve.hpp"
+#include "sort.hpp"
+#include "spectrum.hpp"
+#include "time_point.hpp"
 #include "unit.hpp"
 
 using namespace units;
 
+namespace {
+
+// Allocations made by threads while they hold an AllocationGuard.
+thread_local bool allocation_guarded = false;
+std::atomic<size_t> guarded_allocations(0);
+
+struct AllocationGuard {
+  AllocationGuard() { allocation_guarded = true; }
+  ~AllocationGuard() { allocation_guarded = false; }
+};
+
+void CountAllocation() noexcept {
+  if (allocation_guarded) ++guarded_allocations;
+}
+
+}  // namespace
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#define UNITS_TEST_SANITIZED 1
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define UNITS_TEST_SANITIZED 1
+#endif
+
+// Sanitizers interpose the allocator themselves and abort with it replaced, so sanitized builds count no allocations.
+#if defined(UNITS_TEST_SANITIZED)
+#elif defined(__GLIBC__)
+// Hook malloc itself, which also catches operator new and allocations inside the C library.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+
+void* malloc(size_t size) noexcept {
+  CountAllocation();
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+  CountAllocation();
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, size_t size) noexcept {
+  CountAllocation();
+  return __libc_realloc(p, size);
+}
+}
+#else
+void* operator new(size_t size) {
+  CountAllocation();
+  if (void* p = std::malloc(size)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  CountAllocation();
+  if (void* p = std::malloc(size)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+#endif
+
 TEST_CASE( "Unit arithmetic") {
   constexpr Unit<double, 0, 0, 0, 0, 0, 0, 0, 5, 7> t1(2.0);
   constexpr Unit<double, 0, 0, 0, 0, 0, 0, 0, 2, 3> t2(3.0);
@@ -42,4 +151,1301 @@ TEST_CASE( "Unit arithmetic") {
 
   REQUIRE((meter * sec * kg) == (Unit<int64_t, 1, 1, 0, 0, 0, 0, 1, 1000, 1>(100)));
   REQUIRE((meter * sec * g) == (Unit<int64_t, 1, 1, 0, 0, 0, 0, 1, 1000, 1>(100)));
+
+  REQUIRE(static_cast<i::Millimeter>(meter).GetValue() == 100000);
+  REQUIRE(static_cast<i::Kilogram>(g).GetValue() == 1);
+}
+
+TEST_CASE( "Counter-based random generation") {
+  uint32_t w[4];
+  Philox4x32(0).Generate(0, 1, &w[0], &w[1], &w[2], &w[3]);
+  REQUIRE(w[0] == 0x6627e8d5);
+  REQUIRE(w[1] == 0xe169c58d);
+  REQUIRE(w[2] == 0xbc57ac4c);
+  REQUIRE(w[3] == 0x9b00dbd8);
+
+  const Philox4x32 rng(42, 7);
+  std::vector<d::Meter> whole(1001);
+  std::vector<d::Meter> split(1001);
+  GenerateNormal(rng, 5, whole.data(), 1001, d::Meter(1.0), d::Millimeter(10.0));
+  GenerateNormal(rng, 5, split.data(), 333, d::Meter(1.0), d::Millimeter(10.0));
+  GenerateNormal(rng, 338, split.data() + 333, 668, d::Meter(1.0), d::Millimeter(10.0));
+  double sum = 0.0;
+  for (size_t i = 0; i < 1001; ++i) {
+    REQUIRE(whole[i] == split[i]);
+    sum += whole[i].GetValue();
+  }
+  REQUIRE(std::abs(sum / 1001 - 1.0) < 0.002);
+
+  std::vector<i::Millisecond> ms(500);
+  GenerateUniform(rng, 0, ms.data(), 500, i::Second(1), i::Second(2));
+  for (const auto& t : ms) {
+    REQUIRE(t >= i::Second(1));
+    REQUIRE(t < i::Second(2));
+  }
+
+  std::vector<d::Second> wait(1000);
+  GenerateExponential(rng, 0, wait.data(), 1000, d::Millisecond(250.0));
+  for (const auto& t : wait) {
+    REQUIRE(t.GetValue() >= 0.0);
+  }
+}
+
+TEST_CASE( "Measurement propagation") {
+  using M = Measurement<double>;
+  using MMeter = Unit<M, 0, 1, 0, 0, 0, 0, 0>;
+  using MMillimeter = Unit<M, 0, 1, 0, 0, 0, 0, 0, 1, 1000>;
+  using MSecond = Unit<M, 1, 0, 0, 0, 0, 0, 0>;
+
+  const MMeter a(M(3.0, 0.3));
+  const MMeter b(M(4.0, 0.4));
+  const auto area = a * b;
+  REQUIRE(area.GetValue().GetValue() == 12.0);
+  REQUIRE(std::abs(area.GetValue().GetSigma() - std::sqrt(1.2 * 1.2 + 1.2 * 1.2)) < 1e-12);
+  REQUIRE((a + b).GetValue().GetSigma() == Approx(0.5));
+  REQUIRE(Difference(a.GetValue(), a.GetValue(), 1.0).GetSigma() == Approx(0.0));
+
+  const auto speed = a / MSecond(M(2.0, 0.0));
+  REQUIRE(speed.GetValue().GetValue() == 1.5);
+  REQUIRE(speed.GetValue().GetSigma() == Approx(0.15));
+
+  const MMeter c = MMillimeter(M(500.0, 10.0));
+  REQUIRE(c.GetValue().GetValue() == Approx(0.5));
+  REQUIRE(c.GetValue().GetSigma() == Approx(0.01));
+
+  MeasurementArray<MMeter> x(3);
+  MeasurementArray<MMillimeter> y(3);
+  for (size_t i = 0; i < 3; ++i) {
+    x.Set(i, MMeter(M(1.0 + i, 0.1)));
+    y.Set(i, MMillimeter(M(100.0, 1.0)));
+  }
+  const auto sum = Add(x, y);
+  REQUIRE(sum.Get(2) == MMeter(M(3.1)));
+  const auto ratio = Divide(x, y);
+  REQUIRE(ratio.Get(0).GetNum() == 1000);
+  REQUIRE(ratio.Get(0).GetValue().GetValue() == Approx(0.01));
+
+  MeasurementArray<MMillimeter> shorter(2);
+  REQUIRE_THROWS_AS(Add(x, shorter), const std::invalid_argument&);
+  REQUIRE_THROWS_AS(Multiply(x, shorter), const std::invalid_argument&);
+  REQUIRE_THROWS_AS(Divide(x, shorter), const std::invalid_argument&);
+  REQUIRE_THROWS_AS(Difference(a.GetValue(), b.GetValue(), 1.5), const std::invalid_argument&);
+  REQUIRE_THROWS_AS(Product(a.GetValue(), b.GetValue(), -1.01), const std::invalid_argument&);
+  REQUIRE(Quotient(a.GetValue(), a.GetValue(), 1.0).GetSigma() == Approx(0.0));
+}
+
+TEST_CASE( "Forward-mode differentiation") {
+  using D = Dual<double>;
+  const auto h = MakeVariable(d::Meter(10.0));
+  const d::Kilogram::rebind<D> m(D(2.0));
+  const auto accel = d::Meter::rebind<D>(D(9.8)) / (d::Second::rebind<D>(D(1.0)) * d::Second::rebind<D>(D(1.0)));
+  const auto energy = m * accel * h;
+  REQUIRE(Value(energy).GetValue() == Approx(196.0));
+
+  const auto force = Derivative(energy, h);
+  using Force = decltype(d::Kilogram(1.0) * d::Meter(1.0) / (d::Second(1.0) * d::Second(1.0)));
+  REQUIRE((std::is_same<decltype(force), const Force>::value));
+  REQUIRE(force.GetValue() == Approx(19.6));
+
+  using D2 = Dual<double, 2>;
+  const auto x = MakeVariable<2>(d::Meter(3.0), 0);
+  const auto t = MakeVariable<2>(d::Second(2.0), 1);
+  const auto v = x / t;
+  REQUIRE(Derivative(v, x, 0).GetValue() == Approx(0.5));
+  REQUIRE(Derivative(v, t, 1).GetValue() == Approx(-0.75));
+  REQUIRE((std::is_same<decltype(Derivative(v, t, 1)), Unit<double, -2, 1, 0, 0, 0, 0, 0>>::value));
+
+  const D2 s = sin(D2::Variable(0.5, 1));
+  REQUIRE(s.GetDerivative(0) == 0.0);
+  REQUIRE(s.GetDerivative(1) == Approx(std::cos(0.5)));
+}
+
+TEST_CASE( "Interval arithmetic") {
+  using I = Interval<double>;
+  const IntervalUnit<d::Meter> distance(I(99.0, 101.0));
+  const IntervalUnit<d::Second> time(I(9.0, 11.0));
+  const auto speed = distance / time;
+  REQUIRE((std::is_same<decltype(speed), const decltype(d::Meter(1.0) / d::Second(1.0))::rebind<I>>::value));
+  REQUIRE(speed.GetValue().GetLower() <= 9.0);
+  REQUIRE(speed.GetValue().GetUpper() >= 101.0 / 9.0);
+  REQUIRE(speed.GetValue().Contains(10.0));
+
+  const IntervalUnit<d::Meter> tenth(I(0.1));
+  const auto sum = tenth + tenth + tenth;
+  REQUIRE(sum.GetValue().Contains(0.1 + 0.1 + 0.1));
+  REQUIRE(sum.GetValue().GetLower() < 0.3);
+  REQUIRE(sum.GetValue().GetUpper() > 0.3);
+  REQUIRE(sum.GetValue().GetWidth() < 1e-15);
+
+  const IntervalUnit<d::Meter> mm = IntervalUnit<d::Millimeter>(I(5.0, 6.0));
+  REQUIRE(mm.GetValue().Contains(0.005));
+  REQUIRE(mm.GetValue().Contains(0.006));
+  REQUIRE(IntervalUnit<d::Meter>(I(1.0, 2.0)) < IntervalUnit<d::Meter>(I(3.0, 4.0)));
+
+  const Interval<double, RoundDirected> third = Interval<double, RoundDirected>(1.0) / Interval<double, RoundDirected>(3.0);
+  REQUIRE(third.GetLower() <= 1.0 / 3.0);
+  REQUIRE(third.GetUpper() >= 1.0 / 3.0);
+
+  IntervalArray<IntervalUnit<d::Meter>> x(4);
+  IntervalArray<IntervalUnit<d::Second>> t(4);
+  for (size_t i = 0; i < 4; ++i) {
+    x.Set(i, IntervalUnit<d::Meter>(I(10.0 * i, 10.0 * i + 1.0)));
+    t.Set(i, IntervalUnit<d::Second>(I(i - 0.5, i + 0.5)));
+  }
+  const auto v = Divide(x, t);
+  REQUIRE(std::isinf(v.Get(0).GetValue().GetUpper()));
+  REQUIRE(v.Get(2).GetValue().Contains(20.0 / 2.0));
+  REQUIRE(v.Get(2).GetValue().GetLower() <= 20.0 / 2.5);
+  const auto area = Multiply(x, x);
+  REQUIRE(area.Get(3).GetValue().Contains(900.0));
+  REQUIRE(area.Get(3).GetValue().Contains(961.0));
+  const IntervalArray<IntervalUnit<d::Second>> single(1);
+  REQUIRE_THROWS_AS(Add(x, IntervalArray<IntervalUnit<d::Meter>>(1)), const std::invalid_argument&);
+  REQUIRE_THROWS_AS(Multiply(x, single), const std::invalid_argument&);
+  REQUIRE_THROWS_AS(Divide(x, single), const std::invalid_argument&);
+}
+
+TEST_CASE( "Physical constants") {
+  using Joule = Unit<double, -2, 2, 0, 0, 0, 0, 1, 1000, 1>;
+  constexpr Joule thermal(4.141947e-21);
+  constexpr auto temperature = thermal / constants::kBoltzmann;
+  static_assert(std::is_same<decltype(temperature), const Unit<double, 0, 0, 0, 1, 0, 0, 0, 1000, 1380649>>::value,
+                "Temperature type");
+  REQUIRE(static_cast<d::Kelvin>(temperature).GetValue() == Approx(300.0));
+
+  constexpr auto c = constants::kSpeedOfLight;
+  REQUIRE(c.GetValue() == 1.0);
+  REQUIRE(static_cast<d::Meter>(c * d::Second(2.0)).GetValue() == 599584916.0);
+  REQUIRE(static_cast<Joule>(constants::kElectronMass * c * c).GetValue() == Approx(8.1871057769e-14));
+  REQUIRE(static_cast<Joule>(constants::kPlanck * constants::kCaesiumFrequency).GetValue() == Approx(6.0911e-24).epsilon(1e-4));
+  REQUIRE((static_cast<d::Meter>(constants::kStandardGravity * d::Second(1.0) * d::Second(1.0))).GetValue() == 9.80665);
+}
+
+TEST_CASE( "Non-SI units") {
+  using MeterPerSecond = decltype(d::Meter(1.0) / d::Second(1.0));
+  constexpr auto feet_per_minute = d::Foot(100.0) / d::Minute(1.0);
+  constexpr MeterPerSecond speed = feet_per_minute;
+  REQUIRE(speed.GetValue() == Approx(0.508));
+  REQUIRE(static_cast<MeterPerSecond>(d::Knot(1.0)).GetValue() == Approx(1852.0 / 3600.0));
+  REQUIRE(static_cast<d::Radian>(d::Degree(180.0)).GetValue() == 3.141592653589793);
+  REQUIRE(static_cast<d::Degree>(d::Radian(3.141592653589793)).GetValue() == Approx(180.0).epsilon(1e-15));
+  REQUIRE(static_cast<d::Pascal>(d::Psi(1.0)).GetValue() == Approx(6894.757293168361));
+  REQUIRE(static_cast<i::Millimeter>(i::Inch(10)).GetValue() == 254);
+  REQUIRE(i::Hour(2) == i::Minute(120));
+  REQUIRE(d::Mile(1.0) > d::NauticalMile(0.5));
+
+  const d::Foot feet[3] = {d::Foot(1.0), d::Foot(10.0), d::Foot(100.0)};
+  d::Meter meters[3];
+  Convert(feet, meters, 3);
+  REQUIRE(meters[1].GetValue() == Approx(3.048));
+  REQUIRE(meters[2].GetValue() == static_cast<d::Meter>(feet[2]).GetValue());
+}
+
+TEST_CASE( "Decibel levels") {
+  const auto p = DecibelMilliwatt::FromLinear(Watt(1.0));
+  REQUIRE(p.GetValue() == Approx(30.0));
+  REQUIRE((p + Decibel(-3.0)).GetValue() == Approx(27.0));
+  REQUIRE((p - DecibelMilliwatt(10.0)).GetValue() == Approx(20.0));
+  REQUIRE(static_cast<Watt>(DecibelWatt(20.0).ToLinear()).GetValue() == Approx(100.0));
+  REQUIRE(Decibel::FromNepers(1.0).GetValue() == Approx(8.685889638));
+  REQUIRE(DecibelVolt::FromLinear(Volt(10.0)).GetValue() == Approx(20.0));
+
+  std::vector<Watt> linear;
+  for (int e = -12; e <= 12; ++e) {
+    linear.push_back(Watt(1.7 * std::pow(10.0, e)));
+  }
+  linear.push_back(Watt(0.0));
+  std::vector<DecibelMilliwatt> levels(linear.size());
+  ToLevels(linear.data(), levels.data(), linear.size());
+  for (size_t i = 0; i + 1 < linear.size(); ++i) {
+    REQUIRE(levels[i].GetValue() == Approx(DecibelMilliwatt::FromLinear(linear[i]).GetValue()).epsilon(1e-12));
+  }
+  REQUIRE(std::isinf(levels.back().GetValue()));
+
+  ApplyGain(levels.data(), levels.size() - 1, Decibel(10.0));
+  std::vector<Watt> back(levels.size() - 1);
+  ToLinear(levels.data(), back.data(), back.size());
+  for (size_t i = 0; i < back.size(); ++i) {
+    REQUIRE(back[i].GetValue() == Approx(10.0 * linear[i].GetValue()).epsilon(1e-12));
+  }
+}
+
+TEST_CASE( "k-d tree queries") {
+  using Tree = KdTree<d::Meter, 3>;
+  const Philox4x32 rng(3);
+  std::vector<d::Meter> raw(3 * 2000);
+  GenerateUniform(rng, 0, raw.data(), raw.size(), d::Meter(-50.0), d::Meter(50.0));
+  std::vector<Tree::Point> points(2000);
+  for (size_t i = 0; i < points.size(); ++i) {
+    points[i] = {{raw[3 * i], raw[3 * i + 1], raw[3 * i + 2]}};
+  }
+  const Tree tree(points.data(), points.size());
+
+  const auto distance = [&](const Tree::Point& a, size_t i) {
+    double d2 = 0.0;
+    for (size_t k = 0; k < 3; ++k) {
+      d2 += std::pow(a[k].GetValue() - points[i][k].GetValue(), 2);
+    }
+    return std::sqrt(d2);
+  };
+
+  std::vector<Tree::Point> queries(64);
+  for (size_t i = 0; i < queries.size(); ++i) {
+    queries[i] = {{d::Meter(i - 32.0), d::Meter(0.5 * i), d::Meter(10.0)}};
+  }
+  std::vector<Tree::Neighbor> nearest(queries.size());
+  tree.NearestBatch(queries.data(), queries.size(), nearest.data(), 4);
+  std::vector<std::vector<Tree::Neighbor>> within;
+  tree.RadiusBatch(queries.data(), queries.size(), d::Centimeter(1500.0), &within, 3);
+
+  for (size_t q = 0; q < queries.size(); ++q) {
+    size_t best = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+      if (distance(queries[q], i) < distance(queries[q], best)) best = i;
+      if (distance(queries[q], i) <= 15.0) ++count;
+    }
+    REQUIRE(nearest[q].index == best);
+    REQUIRE(nearest[q].distance.GetValue() == Approx(distance(queries[q], best)));
+    REQUIRE(within[q].size() == count);
+  }
+
+  // Integral coordinates: the radius and the distances are kept exact in double instead of truncated to meters.
+  using GridTree = KdTree<i::Meter, 2>;
+  const GridTree::Point grid[] = {
+      {{i::Meter(0), i::Meter(0)}}, {{i::Meter(1), i::Meter(1)}}, {{i::Meter(2), i::Meter(0)}}};
+  const GridTree grid_tree(grid, 3);
+  std::vector<GridTree::Neighbor> near;
+  grid_tree.Radius(grid[0], i::Millimeter(1500), &near);
+  REQUIRE(near.size() == 2);
+  std::vector<std::vector<GridTree::Neighbor>> near_batch;
+  grid_tree.RadiusBatch(grid, 1, i::Millimeter(1500), &near_batch, 1);
+  REQUIRE(near_batch[0].size() == 2);
+  const GridTree::Point off_grid = {{i::Meter(1), i::Meter(0)}};
+  REQUIRE(grid_tree.Nearest(off_grid).distance.GetValue() == Approx(1.0));
+  for (const auto& neighbor : near) {
+    if (neighbor.index == 1) REQUIRE(neighbor.distance.GetValue() == Approx(std::sqrt(2.0)));
+  }
+}
+
+TEST_CASE( "Radix sort") {
+  const Philox4x32 rng(11);
+  std::vector<d::Meter> lengths(100000);
+  GenerateNormal(rng, 0, lengths.data(), lengths.size(), d::Meter(0.0), d::Kilometer(1.0));
+  lengths[7] = d::Meter(-0.0);
+  lengths[8] = d::Meter(std::numeric_limits<double>::infinity());
+  lengths[9] = d::Meter(-std::numeric_limits<double>::infinity());
+  std::vector<double> expected(lengths.size());
+  for (size_t i = 0; i < lengths.size(); ++i) {
+    expected[i] = lengths[i].GetValue();
+  }
+  std::stable_sort(expected.begin(), expected.end());
+
+  std::vector<double> companion(lengths.size());
+  std::vector<int> tags(lengths.size());
+  for (size_t i = 0; i < lengths.size(); ++i) {
+    companion[i] = 2.0 * lengths[i].GetValue();
+    tags[i] = static_cast<int>(i);
+  }
+  std::vector<d::Meter> original = lengths;
+  RadixSortByKey(lengths.data(), lengths.size(), 4, companion.data(), tags.data());
+  for (size_t i = 0; i < lengths.size(); ++i) {
+    REQUIRE(lengths[i].GetValue() == expected[i]);
+    REQUIRE(companion[i] == 2.0 * expected[i]);
+    REQUIRE(original[tags[i]] == lengths[i]);
+  }
+
+  // A single thread gathers every column.
+  std::vector<d::Meter> keys = original;
+  std::vector<int> first(keys.size()), second(keys.size()), third(keys.size());
+  std::iota(first.begin(), first.end(), 0);
+  second = first;
+  third = first;
+  RadixSortByKey(keys.data(), keys.size(), 1, first.data(), second.data(), third.data());
+  REQUIRE(keys == lengths);
+  REQUIRE(first == tags);
+  REQUIRE(second == tags);
+  REQUIRE(third == tags);
+
+  std::vector<i::Nanosecond> stamps(70000);
+  for (size_t i = 0; i < stamps.size(); ++i) {
+    stamps[i] = i::Nanosecond(static_cast<int64_t>((i * 2654435761u) % 100003) - 50000);
+  }
+  std::vector<size_t> order(stamps.size());
+  RadixArgsort(stamps.data(), stamps.size(), order.data(), 3);
+  for (size_t i = 1; i < order.size(); ++i) {
+    REQUIRE(stamps[order[i - 1]] <= stamps[order[i]]);
+    if (stamps[order[i - 1]] == stamps[order[i]]) {
+      REQUIRE(order[i - 1] < order[i]);
+    }
+  }
+  RadixSort(stamps.data(), stamps.size());
+  REQUIRE(std::is_sorted(stamps.begin(), stamps.end(), [](i::Nanosecond a, i::Nanosecond b) { return a < b; }));
+
+  // A failure on the calling thread joins the running workers before it propagates.
+  std::atomic<unsigned> finished(0);
+  REQUIRE_THROWS_AS(detail::ParallelTasks(4, [&](unsigned t) {
+                      if (t == 0) throw std::invalid_argument("task zero");
+                      ++finished;
+                    }),
+                    const std::invalid_argument&);
+  REQUIRE(finished == 3);
+}
+
+TEST_CASE( "Time series joins") {
+  std::vector<i::Microsecond> left;
+  std::vector<i::Nanosecond> right;
+  for (int64_t t = 0; t < 3000; ++t) {
+    left.push_back(i::Microsecond(3 * t + 1));
+    right.push_back(i::Nanosecond(7 * t * 331));
+  }
+
+  std::vector<size_t> match(left.size());
+  AsOfJoin(left.data(), left.size(), right.data(), right.size(), match.data(), 4);
+  std::vector<size_t> near(left.size());
+  AsOfJoin(left.data(), left.size(), right.data(), right.size(), i::Nanosecond(1000), near.data(), 4);
+  std::vector<JoinRange> window(left.size());
+  WindowJoin(left.data(), left.size(), right.data(), right.size(), i::Nanosecond(2500), window.data(), 3);
+
+  for (size_t i = 0; i < left.size(); ++i) {
+    size_t expected = right.size();
+    size_t lo = right.size();
+    size_t hi = 0;
+    for (size_t j = 0; j < right.size() && right[j] <= left[i]; ++j) {
+      expected = j;
+    }
+    for (size_t j = 0; j < right.size(); ++j) {
+      const int64_t diff = right[j].GetValue() - 1000 * left[i].GetValue();
+      if (diff >= -2500 && diff <= 2500) {
+        lo = std::min(lo, j);
+        hi = j + 1;
+      }
+    }
+    REQUIRE(match[i] == expected);
+    const bool close = expected != right.size() && 1000 * left[i].GetValue() - right[expected].GetValue() <= 1000;
+    REQUIRE(near[i] == (close ? expected : right.size()));
+    if (lo == right.size()) {
+      REQUIRE(window[i].begin == window[i].end);
+    } else {
+      REQUIRE(window[i].begin == lo);
+      REQUIRE(window[i].end == hi);
+    }
+  }
+}
+
+TEST_CASE( "Interval index") {
+  const Philox4x32 rng(5);
+  const size_t n = 5000;
+  std::vector<i::Millisecond> starts(n);
+  std::vector<i::Millisecond> lengths(n);
+  GenerateUniform(rng, 0, starts.data(), n, i::Second(0), i::Second(3600));
+  GenerateExponential(rng, n, lengths.data(), n, i::Second(30));
+  std::vector<i::Millisecond> ends(n);
+  for (size_t k = 0; k < n; ++k) {
+    ends[k] = i::Millisecond(starts[k].GetValue() + lengths[k].GetValue());
+  }
+  const IntervalIndex<i::Millisecond> index(starts.data(), ends.data(), n, 2);
+
+  std::vector<i::Second> points;
+  std::vector<i::Minute> minutes;
+  for (int64_t t = 0; t < 3600; t += 37) {
+    points.push_back(i::Second(t));
+    minutes.push_back(i::Minute(t / 60 + 2));
+  }
+  std::vector<std::vector<uint32_t>> stabbed;
+  index.StabBatch(points.data(), points.size(), &stabbed, 4);
+  std::vector<std::vector<uint32_t>> overlapping;
+  index.OverlapBatch(points.data(), minutes.data(), points.size(), &overlapping, 4);
+
+  for (size_t q = 0; q < points.size(); ++q) {
+    std::vector<uint32_t> expected_stab;
+    std::vector<uint32_t> expected_overlap;
+    for (size_t k = 0; k < n; ++k) {
+      if (starts[k] <= points[q] && ends[k] >= points[q]) expected_stab.push_back(static_cast<uint32_t>(k));
+      if (starts[k] <= minutes[q] && ends[k] >= points[q]) expected_overlap.push_back(static_cast<uint32_t>(k));
+    }
+    std::sort(stabbed[q].begin(), stabbed[q].end());
+    std::sort(overlapping[q].begin(), overlapping[q].end());
+    REQUIRE(stabbed[q] == expected_stab);
+    REQUIRE(overlapping[q] == expected_overlap);
+  }
+
+  // Integral queries in a finer ratio than the index are not truncated toward zero.
+  const i::Second coarse_starts[] = {i::Second(0), i::Second(2), i::Second(-3)};
+  const i::Second coarse_ends[] = {i::Second(1), i::Second(4), i::Second(-2)};
+  const IntervalIndex<i::Second> coarse(coarse_starts, coarse_ends, 3);
+  std::vector<uint32_t> found;
+  coarse.Stab(i::Millisecond(1500), &found);
+  REQUIRE(found.empty());
+  coarse.Stab(i::Millisecond(-1500), &found);
+  REQUIRE(found.empty());
+  coarse.Stab(i::Millisecond(-2000), &found);
+  REQUIRE((found == std::vector<uint32_t>{2}));
+  found.clear();
+  coarse.Overlap(i::Millisecond(1200), i::Millisecond(1900), &found);
+  REQUIRE(found.empty());
+  coarse.Overlap(i::Millisecond(900), i::Millisecond(2100), &found);
+  REQUIRE((found == std::vector<uint32_t>{0, 1}));
+  found.clear();
+  coarse.Overlap(i::Millisecond(-2500), i::Millisecond(500), &found);
+  std::sort(found.begin(), found.end());
+  REQUIRE((found == std::vector<uint32_t>{0, 2}));
+}
+
+TEST_CASE( "Quaternion rotations") {
+  const auto q = Quaternion<double>::FromAxisAngle({{0.0, 0.0, 2.0}}, d::Degree(90.0));
+  REQUIRE(q.GetAngle().GetValue() == Approx(std::acos(-1.0) / 2));
+  const Vec3<d::Millimeter> v{d::Millimeter(1.0), d::Millimeter(0.0), d::Millimeter(5.0)};
+  const Vec3<d::Millimeter> r = q.Rotate(v);
+  REQUIRE(std::abs(r.x.GetValue()) < 1e-12);
+  REQUIRE(r.y.GetValue() == Approx(1.0));
+  REQUIRE(r.z.GetValue() == Approx(5.0));
+
+  const auto e = Quaternion<double>::FromEuler(d::Milliradian(300.0), d::Radian(-0.2), d::Degree(45.0));
+  const auto composed = Quaternion<double>::FromAxisAngle({{0.0, 0.0, 1.0}}, d::Degree(45.0)) *
+                        Quaternion<double>::FromAxisAngle({{0.0, 1.0, 0.0}}, d::Radian(-0.2)) *
+                        Quaternion<double>::FromAxisAngle({{1.0, 0.0, 0.0}}, d::Radian(0.3));
+  REQUIRE(e.GetW() == Approx(composed.GetW()));
+  REQUIRE(e.GetX() == Approx(composed.GetX()));
+
+  std::vector<d::Meter> x(1000), y(1000), z(1000);
+  GenerateUniform(Philox4x32(9), 0, x.data(), x.size(), d::Meter(-1.0), d::Meter(1.0));
+  GenerateUniform(Philox4x32(9), 1000, y.data(), y.size(), d::Meter(-1.0), d::Meter(1.0));
+  GenerateUniform(Philox4x32(9), 2000, z.data(), z.size(), d::Meter(-1.0), d::Meter(1.0));
+  std::vector<d::Meter> ox(1000), oy(1000), oz(1000);
+  e.RotateBatch(x.data(), y.data(), z.data(), ox.data(), oy.data(), oz.data(), x.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    const Vec3<d::Meter> expected = e.Rotate(Vec3<d::Meter>{x[i], y[i], z[i]});
+    REQUIRE(std::abs(ox[i].GetValue() - expected.x.GetValue()) < 1e-12);
+    REQUIRE(std::abs(oy[i].GetValue() - expected.y.GetValue()) < 1e-12);
+    REQUIRE(std::abs(oz[i].GetValue() - expected.z.GetValue()) < 1e-12);
+  }
+}
+
+TEST_CASE( "Root finding and minimization") {
+  using MeterPerSecond = decltype(d::Meter(1.0) / d::Second(1.0));
+  const auto position = [](d::Second t) { return d::Meter(0.5 * 9.8 * t.GetValue() * t.GetValue() - 100.0); };
+  const auto speed = [](d::Second t) { return MeterPerSecond(9.8 * t.GetValue()); };
+  const double expected = std::sqrt(200.0 / 9.8);
+
+  const auto bisect = Bisect(position, d::Second(0.0), d::Second(10.0), d::Microsecond(1.0));
+  REQUIRE(bisect.converged);
+  REQUIRE(std::abs(bisect.x.GetValue() - expected) < 1e-6);
+  const auto brent = Brent(position, d::Second(0.0), d::Second(10.0), d::Nanosecond(1.0));
+  REQUIRE(brent.converged);
+  REQUIRE(brent.iterations < bisect.iterations);
+  REQUIRE(std::abs(brent.x.GetValue() - expected) < 1e-9);
+  const auto newton = Newton(position, speed, d::Second(1.0), d::Nanosecond(1.0));
+  REQUIRE(newton.converged);
+  REQUIRE(newton.x.GetValue() == Approx(expected));
+  const auto golden = GoldenSection([](d::Meter x) { return d::Second((x.GetValue() - 3.0) * (x.GetValue() - 3.0)); },
+                                    d::Meter(0.0), d::Kilometer(0.01), d::Micrometer(1.0));
+  REQUIRE(std::abs(golden.x.GetValue() - 3.0) < 1e-6);
+
+  const size_t n = 1000;
+  std::vector<double> heights(n);
+  std::vector<d::Second> lo(n, d::Second(0.0)), hi(n, d::Second(100.0)), best(n);
+  std::vector<d::Meter> from(n, d::Meter(-10.0)), to(n, d::Meter(10.0)), argmin(n);
+  for (size_t i = 0; i < n; ++i) {
+    heights[i] = 1.0 + i;
+  }
+  const auto crossing = [&](size_t lane, d::Second t) {
+    return d::Meter(0.5 * 9.8 * t.GetValue() * t.GetValue() - heights[lane]);
+  };
+  BisectBatch(crossing, lo.data(), hi.data(), n, d::Microsecond(1.0));
+  const auto bowl = [&](size_t lane, d::Meter x) { return d::Meter(std::pow(x.GetValue() - 0.01 * lane, 2)); };
+  GoldenSectionBatch(bowl, from.data(), to.data(), n, d::Micrometer(1.0), argmin.data());
+  for (size_t i = 0; i < n; ++i) {
+    REQUIRE(lo[i].GetValue() <= std::sqrt(2.0 * heights[i] / 9.8));
+    REQUIRE(hi[i].GetValue() >= std::sqrt(2.0 * heights[i] / 9.8));
+    REQUIRE(hi[i].GetValue() - lo[i].GetValue() <= 1e-6);
+    REQUIRE(std::abs(argmin[i].GetValue() - 0.01 * i) < 1e-6);
+  }
+
+  // Brackets whose ends do not differ in sign are reported instead of narrowed onto an end.
+  REQUIRE_FALSE(Bisect(position, d::Second(5.0), d::Second(10.0), d::Microsecond(1.0)).converged);
+  REQUIRE_FALSE(Brent(position, d::Second(5.0), d::Second(10.0), d::Nanosecond(1.0)).converged);
+  const auto at_end = Bisect(position, d::Second(0.0), d::Second(std::sqrt(200.0 / 9.8)), d::Microsecond(1.0));
+  REQUIRE(at_end.converged);
+  REQUIRE(at_end.x.GetValue() == Approx(expected));
+  d::Second lanes_lo[] = {d::Second(0.0), d::Second(5.0)}, lanes_hi[] = {d::Second(10.0), d::Second(10.0)};
+  bool bracketed[2];
+  BisectBatch([&](size_t, d::Second t) { return position(t); }, lanes_lo, lanes_hi, 2, d::Microsecond(1.0), 200,
+              bracketed);
+  REQUIRE(bracketed[0]);
+  REQUIRE_FALSE(bracketed[1]);
+  REQUIRE(std::abs(lanes_lo[0].GetValue() - expected) < 1e-6);
+  REQUIRE(lanes_lo[1].GetValue() == 5.0);
+  REQUIRE(lanes_hi[1].GetValue() == 10.0);
+}
+
+TEST_CASE( "Polynomial evaluation") {
+  using Trajectory = Polynomial<d::Second, d::Meter, 2>;
+  constexpr Trajectory trajectory(d::Kilometer(1.0), d::Meter(20.0) / d::Second(1.0),
+                                  d::Meter(-4.9) / (d::Second(1.0) * d::Second(1.0)));
+  static_assert(trajectory(d::Second(2.0)).GetValue() == 1000.0 + 40.0 - 4.9 * 4.0, "constexpr evaluation");
+  REQUIRE(trajectory.Get<0>().GetValue() == 1000.0);
+  REQUIRE(trajectory(d::Millisecond(500.0)).GetValue() == Approx(1000.0 + 10.0 - 4.9 * 0.25));
+
+  // Coefficients in mixed ratios are converted once: 3 m + 2 m/ms x + 1 mm/s^2 x^2.
+  using MeterPerMillisecond = decltype(d::Meter(1.0) / d::Millisecond(1.0));
+  const Polynomial<d::Second, d::Meter, 2> mixed(d::Meter(3.0), MeterPerMillisecond(2.0),
+                                                 d::Millimeter(1.0) / (d::Second(1.0) * d::Second(1.0)));
+  REQUIRE(mixed.Get<1>().GetValue() == Approx(2000.0));
+  REQUIRE(mixed(d::Second(10.0)).GetValue() == Approx(3.0 + 20000.0 + 0.1));
+
+  using Volt = Unit<double, -3, 2, 0, 0, 0, -1, 1, 1000, 1>;
+  const Polynomial<Volt, d::Kelvin, 5> calibration(
+      d::Kelvin(273.15), d::Kelvin(25.0) / Volt(1.0), d::Kelvin(-0.5) / (Volt(1.0) * Volt(1.0)),
+      d::Kelvin(0.03) / (Volt(1.0) * Volt(1.0) * Volt(1.0)), d::Kelvin(-1e-3) / (Volt(1.0) * Volt(1.0) * Volt(1.0) * Volt(1.0)),
+      d::Kelvin(1e-5) / (Volt(1.0) * Volt(1.0) * Volt(1.0) * Volt(1.0) * Volt(1.0)));
+  using Millivolt = Volt::units<1, 1>;
+  const size_t n = 1000;
+  std::vector<Millivolt> volts(n);
+  std::vector<d::Kelvin> horner(n), estrin(n);
+  for (size_t i = 0; i < n; ++i) {
+    volts[i] = Millivolt(10.0 * i);
+  }
+  calibration.Evaluate(volts.data(), horner.data(), n);
+  calibration.Evaluate(volts.data(), estrin.data(), n, PolynomialScheme::kEstrin);
+  for (size_t i = 0; i < n; ++i) {
+    const double expected = calibration(volts[i]).GetValue();
+    REQUIRE(horner[i].GetValue() == Approx(expected));
+    REQUIRE(estrin[i].GetValue() == Approx(expected));
+  }
+  REQUIRE(horner[100].GetValue() == Approx(273.15 + 25.0 - 0.5 + 0.03 - 1e-3 + 1e-5));
+}
+
+TEST_CASE( "Spectral analysis") {
+  const double pi = 3.14159265358979323846;
+  for (size_t n : {1u, 2u, 12u, 15u, 16u, 100u}) {
+    std::vector<d::Meter> signal(n), re(n / 2 + 1), im(n / 2 + 1);
+    for (size_t i = 0; i < n; ++i) {
+      signal[i] = d::Meter(std::sin(0.3 * i) + 0.01 * i * i);
+    }
+    RealFft(signal.data(), n, re.data(), im.data());
+    for (size_t k = 0; k <= n / 2; ++k) {
+      double er = 0.0, ei = 0.0;
+      for (size_t i = 0; i < n; ++i) {
+        er += signal[i].GetValue() * std::cos(2 * pi * i * k / n);
+        ei -= signal[i].GetValue() * std::sin(2 * pi * i * k / n);
+      }
+      REQUIRE(std::abs(re[k].GetValue() - er) < 1e-9 * n * n);
+      REQUIRE(std::abs(im[k].GetValue() - ei) < 1e-9 * n * n);
+    }
+  }
+  REQUIRE(FftPlan<double>::Get(16) == FftPlan<double>::Get(16));
+
+  // 3 mm amplitude at 50 Hz sampled every millisecond: the density peaks at 50 Hz and integrates to the variance.
+  const size_t n = 1 << 14, segment = 1000;
+  std::vector<d::Millimeter> signal(n);
+  for (size_t i = 0; i < n; ++i) {
+    signal[i] = d::Millimeter(3.0 * std::sin(2 * pi * 50.0 * i / 1000.0));
+  }
+  std::vector<Hertz<double>> frequencies(segment / 2 + 1);
+  std::vector<SpectralDensity<d::Millimeter>> psd(segment / 2 + 1), serial(segment / 2 + 1);
+  Frequencies(segment, d::Millisecond(1.0), frequencies.data());
+  const size_t segments = Welch(signal.data(), n, d::Millisecond(1.0), segment, segment / 2, psd.data(), 4);
+  Welch(signal.data(), n, d::Millisecond(1.0), segment, segment / 2, serial.data(), 1);
+  REQUIRE(segments == 31);
+  REQUIRE(frequencies[1].GetValue() == Approx(1.0));
+  size_t peak = 0;
+  double total = 0.0;
+  for (size_t k = 0; k < psd.size(); ++k) {
+    if (psd[k].GetValue() > psd[peak].GetValue()) peak = k;
+    total += psd[k].GetValue() * frequencies[1].GetValue();
+    REQUIRE(psd[k].GetValue() == Approx(serial[k].GetValue()));
+  }
+  REQUIRE(frequencies[peak].GetValue() == Approx(50.0));
+  REQUIRE(total == Approx(4.5).epsilon(0.01));
+  const SpectralDensity<d::Meter> in_meters = psd[peak];
+  REQUIRE(in_meters.GetValue() == Approx(psd[peak].GetValue() * 1e-6));
+
+  // Invalid segmentations are rejected without touching the output, and empty transforms do nothing.
+  std::vector<SpectralDensity<d::Millimeter>> untouched(psd);
+  REQUIRE(Welch(signal.data(), n, d::Millisecond(1.0), segment, segment, untouched.data()) == 0);
+  REQUIRE(Welch(signal.data(), n, d::Millisecond(1.0), segment, segment + 1, untouched.data()) == 0);
+  REQUIRE(Welch(signal.data(), n, d::Millisecond(1.0), 0, 0, untouched.data()) == 0);
+  for (size_t k = 0; k < psd.size(); ++k) REQUIRE(untouched[k].GetValue() == psd[k].GetValue());
+  REQUIRE(FftPlan<double>::Get(0)->Size() == 0);
+  REQUIRE(RealFftPlan<double>::Get(0)->Bins() == 0);
+  Periodogram(signal.data(), 0, d::Millisecond(1.0), untouched.data());
+  REQUIRE(untouched[0].GetValue() == psd[0].GetValue());
+  // One-sample segments are not windowed, so their density is finite: zero once the mean is removed.
+  Periodogram(signal.data() + 1, 1, d::Millisecond(1.0), untouched.data());
+  REQUIRE(untouched[0].GetValue() == 0.0);
+  REQUIRE(Welch(signal.data(), 4, d::Millisecond(1.0), 1, 0, untouched.data()) == 4);
+  REQUIRE(untouched[0].GetValue() == 0.0);
+}
+
+TEST_CASE( "Formula compilation") {
+  using Volt = Unit<double, -3, 2, 0, 0, 0, -1, 1, 1000, 1>;
+  using Millivolt = Volt::units<1, 1>;
+  using Watt = Unit<double, -3, 2, 0, 0, 0, 0, 1, 1000, 1>;
+  using Kilowatt = Watt::units<1000000, 1>;
+  const std::vector<FormulaColumn> columns = {FormulaColumn::Of<Millivolt>("voltage"),
+                                              FormulaColumn::Of<d::Ampere>("current"),
+                                              FormulaColumn::Of<d::Milliampere>("leak"),
+                                              FormulaColumn::Of<d::Second>("duration")};
+  const size_t n = 1000;
+  std::vector<Millivolt> voltage(n);
+  std::vector<d::Ampere> current(n);
+  std::vector<d::Milliampere> leak(n);
+  std::vector<d::Second> duration(n);
+  for (size_t i = 0; i < n; ++i) {
+    voltage[i] = Millivolt(1000.0 + i);
+    current[i] = d::Ampere(0.5 + 0.001 * i);
+    leak[i] = d::Milliampere(2.0);
+    duration[i] = d::Second(1.0 + i);
+  }
+  const double* data[] = {Values(voltage.data()), Values(current.data()), Values(leak.data()), Values(duration.data())};
+
+  Formula<Kilowatt> power;
+  std::string error;
+  REQUIRE(Formula<Kilowatt>::Compile("voltage * (current - leak) / (2 * 4 / 8)", columns, &power, &error));
+  std::vector<Kilowatt> out(n);
+  power.Evaluate(data, n, out.data());
+  for (size_t i = 0; i < n; ++i) {
+    const double watts = 1e-3 * voltage[i].GetValue() * (current[i].GetValue() - 1e-3 * leak[i].GetValue());
+    REQUIRE(out[i].GetValue() == Approx(watts / 1000.0));
+  }
+  // Three loads, the subtraction, the product and the kilowatt rescale; the milliampere rescale folds into its load
+  // and the constant divisor folds away.
+  REQUIRE(power.Instructions() == 6);
+
+  Formula<d::Second> negated;
+  REQUIRE(Formula<d::Second>::Compile("-duration + 10 * -duration - -3 * duration", columns, &negated));
+  std::vector<d::Second> seconds(n);
+  negated.Evaluate(data, n, seconds.data());
+  REQUIRE(seconds[7].GetValue() == Approx(-8.0 * duration[7].GetValue()));
+
+  Formula<d::Second> constant;
+  REQUIRE(Formula<d::Second>::Compile("duration / duration * duration - (1 + 2) * duration / 3", columns, &constant));
+  constant.Evaluate(data, n, seconds.data());
+  REQUIRE(seconds[5].GetValue() == Approx(0.0));
+  // A formula that was never compiled has no program and leaves the output untouched.
+  const Formula<d::Second> uncompiled;
+  seconds[0] = d::Second(42.0);
+  uncompiled.Evaluate(data, n, seconds.data());
+  REQUIRE(seconds[0].GetValue() == 42.0);
+
+  REQUIRE_FALSE(Formula<Kilowatt>::Compile("voltage + current", columns, &power, &error));
+  REQUIRE(error == "sum of operands with different units at offset 17");
+  REQUIRE_FALSE(Formula<Kilowatt>::Compile("voltage * current * duration", columns, &power, &error));
+  REQUIRE_FALSE(Formula<Kilowatt>::Compile("voltage * resistance", columns, &power, &error));
+  REQUIRE(error == "unknown column 'resistance' at offset 10");
+  REQUIRE_FALSE(Formula<Kilowatt>::Compile("(voltage * current", columns, &power, &error));
+  REQUIRE_FALSE(Formula<Kilowatt>::Compile("voltage * current)", columns, &power, &error));
+}
+
+TEST_CASE( "Unit registry") {
+  std::vector<UnitDefinition> units = SiUnitDefinitions();
+  std::string error;
+  REQUIRE(ParseUnitDefinitions("# site units\n"
+                               "U 0 1 0 0 0 0 0 889/20000\n"
+                               "\n"
+                               "count_per_rev 0 0 0 0 -1 0 0 1\n",
+                               &units, &error));
+  units.push_back(UnitDefinition::Of<d::Kilogram>("kg_alias"));
+
+  UnitRegistry registry;
+  REQUIRE(registry.Read()->Find("m") == nullptr);
+  REQUIRE(registry.Load(units, &error));
+  {
+    const auto reader = registry.Read();
+    REQUIRE(reader->Size() == units.size());
+    for (const auto& unit : units) {
+      const UnitDefinition* found = reader->Find(unit.symbol);
+      REQUIRE(found != nullptr);
+      REQUIRE(found->symbol == unit.symbol);
+      REQUIRE(found->num == unit.num);
+    }
+    REQUIRE(reader->Find("ms")->GetDimensions().SameUnits(Dimensions::Of<d::Millisecond>()));
+    REQUIRE(reader->Find("U")->GetDimensions().scale == Approx(0.04445));
+    REQUIRE(reader->Find("count_per_rev")->exponents[4] == -1);
+    REQUIRE(reader->Find("kg_alias")->num == 1000);
+    REQUIRE(reader->Find("furlong") == nullptr);
+    REQUIRE(reader->Find("") == nullptr);
+  }
+
+  REQUIRE_FALSE(ParseUnitDefinitions("U 0 1 0 0 0 0 889/20000\n", &units, &error));
+  REQUIRE(error == "malformed unit definition on line 1");
+  REQUIRE_FALSE(ParseUnitDefinitions("U 0 1 0 0 0 0 0 1/1000000000000000000000000\n", &units, &error));
+  REQUIRE(error == "malformed unit definition on line 1");
+  REQUIRE_FALSE(ParseUnitDefinitions("U 0 1 0 0 0 0 0 18446744073709551616\n", &units, &error));
+  std::vector<UnitDefinition> widest;
+  REQUIRE(ParseUnitDefinitions("U 0 1 0 0 0 0 0 18446744073709551615\n", &widest, &error));
+  REQUIRE(widest[0].num == std::numeric_limits<uint64_t>::max());
+  units.push_back(UnitDefinition::Of<d::Meter>("U"));
+  REQUIRE_FALSE(registry.Load(units, &error));
+  REQUIRE(error == "duplicate unit symbol 'U'");
+  REQUIRE(registry.Read()->Find("U")->num == 889);
+
+  // Readers keep resolving while the table is reloaded with and without a site unit.
+  units.pop_back();
+  std::vector<UnitDefinition> reduced(units.begin(), units.end() - 1);
+  std::atomic<bool> done(false);
+  std::atomic<size_t> misses(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&] {
+      while (!done) {
+        const auto reader = registry.Read();
+        if (reader->Find("km") == nullptr || reader->Find("U")->num != 889) ++misses;
+      }
+    });
+  }
+  for (int i = 0; i < 200; ++i) {
+    REQUIRE(registry.Load(i % 2 == 0 ? reduced : units));
+  }
+  done = true;
+  for (auto& t : readers) t.join();
+  REQUIRE(misses == 0);
+  REQUIRE(registry.Read()->Find("kg_alias") != nullptr);
+}
+
+TEST_CASE( "Time points") {
+  using UnixSeconds = TimePoint<i::Second, UnixEpoch>;
+  using GpsNanoseconds = TimePoint<i::Nanosecond, GpsEpoch>;
+  using NtpMilliseconds = TimePoint<d::Millisecond, NtpEpoch>;
+
+  const UnixSeconds launch(i::Second(1700000000));
+  const GpsNanoseconds gps(launch);
+  REQUIRE(gps.SinceEpoch().GetValue() == (1700000000LL - 315964800LL) * 1000000000LL);
+  const UnixSeconds back(gps);
+  REQUIRE(back == launch);
+  const NtpMilliseconds ntp(launch);
+  REQUIRE(ntp.SinceEpoch().GetValue() == (1700000000.0 + 2208988800.0) * 1000.0);
+
+  const auto later = gps + i::Millisecond(1500);
+  REQUIRE((later - gps).GetValue() == 1500000000LL);
+  REQUIRE((later - launch).GetValue() == 1500000000LL);
+  REQUIRE(later > gps);
+  REQUIRE((launch - i::Minute(1)).SinceEpoch().GetValue() == 1700000000 - 60);
+
+  static_assert(TimePoint<i::Second, GpsEpoch>(TimePoint<i::Second, UnixEpoch>(i::Second(315964800)))
+                    .SinceEpoch().GetValue() == 0, "constexpr epoch conversion");
+
+  const size_t n = 1000;
+  std::vector<UnixSeconds> unix(n);
+  std::vector<GpsNanoseconds> nanos(n);
+  std::vector<TimePoint<d::Second, GpsEpoch>> seconds(n);
+  for (size_t i = 0; i < n; ++i) {
+    unix[i] = UnixSeconds(i::Second(1600000000 + 37 * i));
+  }
+  ConvertEpoch(unix.data(), nanos.data(), n);
+  ConvertEpoch(nanos.data(), seconds.data(), n);
+  for (size_t i = 0; i < n; ++i) {
+    REQUIRE(nanos[i] == GpsNanoseconds(unix[i]));
+    REQUIRE(seconds[i].SinceEpoch().GetValue() == 1600000000.0 - 315964800.0 + 37.0 * i);
+  }
+
+  // Floating point sources keep their fraction until the final cast into an integer target.
+  const TimePoint<d::Second> fractional(d::Second(1.5));
+  REQUIRE(TimePoint<i::Nanosecond>(fractional).SinceEpoch().GetValue() == 1500000000LL);
+  const TimePoint<d::Second> unix_fraction[] = {TimePoint<d::Second>(d::Second(0.5)),
+                                                TimePoint<d::Second>(d::Second(-0.25))};
+  TimePoint<i::Millisecond, GpsEpoch> gps_millis[2];
+  ConvertEpoch(unix_fraction, gps_millis, 2);
+  REQUIRE(gps_millis[0].SinceEpoch().GetValue() == -315964799500LL);
+  REQUIRE(gps_millis[1].SinceEpoch().GetValue() == -315964800250LL);
+  // Integer shifts with a fractional offset truncate the exact sum once.
+  using Third = Unit<int64_t, 1, 0, 0, 0, 0, 0, 0, 1, 3>;
+  struct ThirdEpoch {
+    using offset = std::ratio<1, 3>;
+  };
+  REQUIRE(TimePoint<i::Second>(TimePoint<Third, ThirdEpoch>(Third(2))).SinceEpoch().GetValue() == 1);
+
+  const auto now = std::chrono::system_clock::now();
+  const TimePoint<i::Microsecond, GpsEpoch> from_chrono(std::chrono::time_point_cast<std::chrono::microseconds>(now));
+  const auto round_trip = from_chrono.ToChrono<std::chrono::system_clock>();
+  REQUIRE(std::chrono::duration_cast<std::chrono::microseconds>(round_trip.time_since_epoch()) ==
+          std::chrono::time_point_cast<std::chrono::microseconds>(now).time_since_epoch());
+  REQUIRE(FromChrono(std::chrono::milliseconds(250)) == i::Millisecond(250));
+  REQUIRE(ToChrono(i::Millisecond(250)) == std::chrono::milliseconds(250));
+}
+
+TEST_CASE( "Seqlock publication") {
+  struct Pose {
+    d::Meter x, y, z;
+    d::Radian heading;
+    uint64_t tick;
+  };
+  static_assert(alignof(SeqLock<Pose>) == kCacheLineSize, "cache line aligned");
+  SeqLock<Pose> pose(Pose{d::Meter(0.0), d::Meter(0.0), d::Meter(0.0), d::Radian(0.0), 0});
+  REQUIRE(pose.Version() == 0);
+
+  const uint64_t ticks = 200000;
+  std::atomic<size_t> torn(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t) {
+    readers.emplace_back([&] {
+      uint64_t last = 0;
+      while (last < ticks) {
+        const Pose p = pose.Load();
+        const double v = double(p.tick);
+        if (p.x.GetValue() != v || p.y.GetValue() != -v || p.z.GetValue() != 2 * v || p.heading.GetValue() != v ||
+            p.tick < last) {
+          ++torn;
+        }
+        last = p.tick;
+      }
+    });
+  }
+  for (uint64_t tick = 1; tick <= ticks; ++tick) {
+    const double v = double(tick);
+    pose.Store(Pose{d::Meter(v), d::Meter(-v), d::Meter(2 * v), d::Radian(v), tick});
+  }
+  for (auto& t : readers) t.join();
+  REQUIRE(torn == 0);
+  REQUIRE(pose.Version() == ticks);
+  Pose latest;
+  REQUIRE(pose.TryLoad(&latest));
+  REQUIRE(latest.tick == ticks);
+}
+
+TEST_CASE( "Text export") {
+  using Volt = Unit<double, -3, 2, 0, 0, 0, -1, 1, 1000, 1>;
+  REQUIRE(std::string(UnitSymbol<d::Kilometer>()) == "km");
+  REQUIRE(std::string(UnitSymbol<d::Kilogram>()) == "kg");
+  REQUIRE(std::string(UnitSymbol<decltype(d::Meter(1.0) / (d::Second(1.0) * d::Second(1.0)))>()) == "m/s^2");
+  REQUIRE(std::string(UnitSymbol<Volt>()) == "kg*m^2/s^3/A");
+  REQUIRE(std::string(UnitSymbol<decltype(d::Kilometer(1.0) * d::Kilometer(1.0))>()) == "km^2");
+  REQUIRE(std::string(UnitSymbol<decltype(d::Meter(1.0) / d::Millisecond(1.0))>()) == "km/s");
+  REQUIRE(std::string(UnitSymbol<d::Inch>()) == "(127/5000)*m");
+  REQUIRE(std::string(UnitSymbol<Unit<double, 0, 0, 0, 0, 0, 0, 0>>()) == "1");
+  static_assert(UnitSymbol<d::Millisecond>()[0] == 'm', "compile-time symbol");
+  REQUIRE(std::string(UnitSymbol<Unit<double, -1, 0, 0, 0, 0, 0, 0, 1000, 1>>()) == "1/ms");
+  REQUIRE(std::string(UnitSymbol<decltype(d::Meter(1.0) / d::Second(1.0))::units<1, 3>>()) == "(1/3)*m/s");
+
+  const size_t n = 10000;
+  std::vector<d::Millisecond> time(n);
+  std::vector<i::Meter> position(n);
+  std::vector<d::Kelvin> temperature(n);
+  for (size_t i = 0; i < n; ++i) {
+    time[i] = d::Millisecond(0.1 * i);
+    position[i] = i::Meter(int64_t(i) - 5000);
+    temperature[i] = d::Kelvin(273.15 + 1.0 / (i + 1));
+  }
+  ExportOptions options;
+  options.block_rows = 777;
+  options.threads = 1;
+  std::ostringstream serial;
+  ExportColumns(serial, {"time", "position", "temperature"}, n, options, time.data(), position.data(),
+                temperature.data());
+  options.threads = 4;
+  std::ostringstream parallel;
+  ExportColumns(parallel, {"time", "position", "temperature"}, n, options, time.data(), position.data(),
+                temperature.data());
+  REQUIRE(serial.str() == parallel.str());
+
+  std::istringstream lines(parallel.str());
+  std::string line;
+  std::getline(lines, line);
+  REQUIRE(line == "time [ms],position [m],temperature [K]");
+  for (size_t i = 0; i < n; ++i) {
+    std::getline(lines, line);
+    std::istringstream fields(line);
+    std::string t, p, k;
+    std::getline(fields, t, ',');
+    std::getline(fields, p, ',');
+    std::getline(fields, k, ',');
+    REQUIRE(std::stod(t) == time[i].GetValue());
+    REQUIRE(std::stoll(p) == position[i].GetValue());
+    REQUIRE(std::stod(k) == temperature[i].GetValue());
+  }
+  REQUIRE_FALSE(std::getline(lines, line));
+
+  options.delimiter = '\t';
+  options.precision = 2;
+  options.header = false;
+  std::ostringstream fixed;
+  ExportColumns(fixed, {"time", "position"}, 2, options, time.data() + 15, position.data());
+  REQUIRE(fixed.str() == "1.50\t-5000\n1.60\t-4999\n");
+  std::ostringstream unnamed;
+  REQUIRE_THROWS_AS(ExportColumns(unnamed, {"time"}, 2, options, time.data(), position.data()),
+                    const std::invalid_argument&);
+  REQUIRE(unnamed.str().empty());
+}
+
+TEST_CASE( "Mergeable aggregates") {
+  const size_t shards = 4, per_shard = 2500;
+  std::vector<d::Meter> samples(shards * per_shard);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    samples[i] = d::Meter(std::sin(0.01 * i) * 50.0 + 0.001 * i);
+  }
+  SumAggregate<d::Meter> sum;
+  MinMaxAggregate<d::Meter> range;
+  MomentsAggregate<d::Meter> moments;
+  HistogramAggregate<d::Meter> histogram(d::Meter(-40.0), d::Decimeter(400.0), 16);
+  std::vector<std::string> partials;
+  for (size_t s = 0; s < shards; ++s) {
+    SumAggregate<d::Meter> shard_sum;
+    MinMaxAggregate<d::Meter> shard_range;
+    MomentsAggregate<d::Meter> shard_moments;
+    HistogramAggregate<d::Meter> shard_histogram(d::Meter(-40.0), d::Meter(40.0), 16);
+    shard_sum.Add(&samples[s * per_shard], per_shard);
+    shard_range.Add(&samples[s * per_shard], per_shard);
+    shard_histogram.Add(&samples[s * per_shard], per_shard);
+    for (size_t i = 0; i < per_shard; ++i) shard_moments.Add(samples[s * per_shard + i]);
+    partials.emplace_back();
+    shard_sum.Serialize(&partials.back());
+    partials.emplace_back();
+    shard_range.Serialize(&partials.back());
+    partials.emplace_back();
+    shard_moments.Serialize(&partials.back());
+    partials.emplace_back();
+    shard_histogram.Serialize(&partials.back());
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  // Ship the partials through a local socket as length-prefixed frames, standing in for the network.
+  int fds[2];
+  REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  std::atomic<bool> sent(true);
+  std::thread worker([&] {
+    for (const auto& partial : partials) {
+      const uint32_t size = static_cast<uint32_t>(partial.size());
+      sent = sent && write(fds[0], &size, sizeof(size)) == ssize_t(sizeof(size)) &&
+             write(fds[0], partial.data(), size) == ssize_t(size);
+    }
+    close(fds[0]);
+  });
+  const auto read_all = [&](char* out, size_t size) {
+    for (size_t done = 0; done < size;) {
+      const ssize_t got = read(fds[1], out + done, size - done);
+      if (got <= 0) return false;
+      done += size_t(got);
+    }
+    return true;
+  };
+  std::vector<std::string> received;
+  uint32_t size;
+  while (read_all(reinterpret_cast<char*>(&size), sizeof(size))) {
+    std::string frame(size, '\0');
+    REQUIRE(read_all(&frame[0], size));
+    received.push_back(frame);
+  }
+  worker.join();
+  close(fds[1]);
+  REQUIRE(sent);
+  REQUIRE(received == partials);
+#endif
+
+  std::string error;
+  for (size_t s = 0; s < shards; ++s) {
+    REQUIRE(sum.MergeSerialized(partials[4 * s].data(), partials[4 * s].size(), &error));
+    REQUIRE(range.MergeSerialized(partials[4 * s + 1].data(), partials[4 * s + 1].size(), &error));
+    REQUIRE(moments.MergeSerialized(partials[4 * s + 2].data(), partials[4 * s + 2].size(), &error));
+    REQUIRE(histogram.MergeSerialized(partials[4 * s + 3].data(), partials[4 * s + 3].size(), &error));
+  }
+  double total = 0.0, lo = 1e300, hi = -1e300;
+  for (const auto& x : samples) {
+    total += x.GetValue();
+    lo = std::min(lo, x.GetValue());
+    hi = std::max(hi, x.GetValue());
+  }
+  const double mean = total / samples.size();
+  double m2 = 0.0;
+  for (const auto& x : samples) m2 += (x.GetValue() - mean) * (x.GetValue() - mean);
+  REQUIRE(sum.GetCount() == samples.size());
+  REQUIRE(sum.GetSum().GetValue() == Approx(total));
+  REQUIRE(range.GetMin().GetValue() == lo);
+  REQUIRE(range.GetMax().GetValue() == hi);
+  REQUIRE(moments.GetMean().GetValue() == Approx(mean));
+  REQUIRE(moments.GetVariance().GetValue() == Approx(m2 / (samples.size() - 1)));
+  uint64_t binned = histogram.GetUnderflow() + histogram.GetOverflow();
+  for (size_t b = 0; b < histogram.Bins(); ++b) binned += histogram.GetCount(b);
+  REQUIRE(binned == samples.size());
+
+  // Partials in other ratios, units, value types, kinds or bins are rejected before merging.
+  std::string kilometers, seconds, integers;
+  SumAggregate<d::Kilometer>().Serialize(&kilometers);
+  SumAggregate<d::Second>().Serialize(&seconds);
+  SumAggregate<i::Meter>().Serialize(&integers);
+  REQUIRE_FALSE(sum.MergeSerialized(kilometers.data(), kilometers.size(), &error));
+  REQUIRE(error == "scale mismatch");
+  REQUIRE_FALSE(sum.MergeSerialized(seconds.data(), seconds.size(), &error));
+  REQUIRE(error == "dimension mismatch");
+  REQUIRE_FALSE(sum.MergeSerialized(integers.data(), integers.size(), &error));
+  REQUIRE(error == "value type mismatch");
+  REQUIRE_FALSE(sum.MergeSerialized(partials[1].data(), partials[1].size(), &error));
+  REQUIRE(error == "aggregate kind mismatch");
+  REQUIRE_FALSE(sum.MergeSerialized(partials[0].data(), partials[0].size() - 1, &error));
+  REQUIRE(error == "malformed aggregate payload");
+  std::string coarse;
+  HistogramAggregate<d::Meter>(d::Meter(-40.0), d::Meter(40.0), 8).Serialize(&coarse);
+  REQUIRE_FALSE(histogram.MergeSerialized(coarse.data(), coarse.size(), &error));
+  REQUIRE(error == "histogram bins mismatch");
+  REQUIRE(sum.GetCount() == samples.size());
+
+  REQUIRE_THROWS_AS(HistogramAggregate<d::Meter>(d::Meter(-40.0), d::Meter(40.0), 0), const std::invalid_argument&);
+  // Offsets across the whole int32_t range would overflow when multiplied by the bin count in int32_t.
+  using Millimeter32 = i::Millimeter::rebind<int32_t>;
+  const int32_t lowest = std::numeric_limits<int32_t>::lowest(), highest = std::numeric_limits<int32_t>::max();
+  HistogramAggregate<Millimeter32> wide(Millimeter32(lowest), Millimeter32(highest), 4);
+  wide.Add(Millimeter32(lowest));
+  wide.Add(Millimeter32(-1));
+  wide.Add(Millimeter32(0));
+  wide.Add(Millimeter32(highest - 1));
+  wide.Add(Millimeter32(highest));
+  REQUIRE(wide.GetCount(0) == 1);
+  REQUIRE(wide.GetCount(1) == 1);
+  REQUIRE(wide.GetCount(2) == 1);
+  REQUIRE(wide.GetCount(3) == 1);
+  REQUIRE(wide.GetUnderflow() == 0);
+  REQUIRE(wide.GetOverflow() == 1);
+}
+
+TEST_CASE( "Scale policies") {
+  using Third = i::Meter::units<1, 3>;
+  using Seventh = i::Meter::units<1, 7>;
+  // operator+ drifts to 1/21 m; the policies stay on a ratio one of the terms already has.
+  REQUIRE((std::is_same<decltype(Third(1) + Seventh(1)), i::Meter::units<1, 21>>::value));
+  REQUIRE((std::is_same<ScaleChoice<CommonScale, Third, Seventh, Third>::type, i::Meter::units<1, 21>>::value));
+  REQUIRE((ScaleChoice<CommonScale, Third, Seventh, Third>::rescales == 3));
+  using DThird = d::Meter::units<1, 3>;
+  using DSeventh = d::Meter::units<1, 7>;
+  REQUIRE((std::is_same<ScaleChoice<FinerScale, DThird, DSeventh, DThird>::type, DThird>::value));
+  REQUIRE((ScaleChoice<FinerScale, DThird, DSeventh, DThird>::rescales == 1));
+  // Integers go to the finest ratio instead, so no term is truncated into a coarser one.
+  REQUIRE((std::is_same<ScaleChoice<FinerScale, Third, Seventh, Third>::type, Seventh>::value));
+  REQUIRE((std::is_same<ScaleChoice<FinerScale, i::Meter, i::Meter, i::Millimeter>::type, i::Millimeter>::value));
+  REQUIRE((std::is_same<ScaleChoice<FinerScale, d::Meter, d::Meter, d::Millimeter>::type, d::Meter>::value));
+
+  REQUIRE((std::is_same<ScaleChoice<FinerScale, i::Centimeter, i::Meter>::type, i::Centimeter>::value));
+  REQUIRE((std::is_same<ScaleChoice<CoarserScale, i::Centimeter, i::Meter>::type, i::Meter>::value));
+  REQUIRE((std::is_same<ScaleChoice<LeftScale, i::Kilometer, i::Millimeter>::type, i::Kilometer>::value));
+  REQUIRE((std::is_same<ScaleChoice<CoarserScale, i::Millimeter, i::Meter, i::Millimeter>::type,
+                        i::Millimeter>::value));
+
+  static_assert(ScaledSum<FinerScale>(i::Millimeter(5), i::Centimeter(2), i::Millimeter(3)).GetValue() == 28, "");
+  const auto finer = ScaledSum<FinerScale>(i::Millimeter(5), i::Centimeter(2), i::Millimeter(3));
+  REQUIRE((std::is_same<decltype(finer), const i::Millimeter>::value));
+  REQUIRE(finer.GetValue() == 28);
+  const auto coarser = ScaledSum<CoarserScale>(i::Meter(2), i::Centimeter(150));
+  REQUIRE((std::is_same<decltype(coarser), const i::Meter>::value));
+  REQUIRE(coarser.GetValue() == 3);
+  REQUIRE(ScaledDifference<FinerScale>(i::Meter(2), i::Centimeter(150)).GetValue() == 50);
+  REQUIRE(ScaledSum<FinerScale>(i::Meter(1), i::Meter(2), i::Millimeter(7)).GetValue() == 3007);
+  REQUIRE(ScaledSum(Third(2), Seventh(3), Third(1)).GetValue() == 14 + 9 + 7);
+  REQUIRE(ScaledSum(Third(2), Seventh(3), Third(1)) == Third(2) + Seventh(3) + Third(1));
+  REQUIRE(ScaledSum<FinerScale>(d::Kilometer(1.5), d::Meter(250.0), d::Meter(0.5)).GetValue() == Approx(1750.5));
+}
+
+TEST_CASE( "Prefix conversion tables") {
+  static_assert(PrefixIndexOf<i::Millisecond>() == 5, "");
+  static_assert(PrefixIndexOf<d::Kilogram>() == 11, "");
+  static_assert(PrefixIndexOf<i::Meter::units<1, 3>>() == kNoPrefix, "");
+  static_assert(PrefixFactor(11, kUnprefixed) == 1000.0, "");
+  REQUIRE(std::string(GetPrefix(PrefixIndexOf<d::Microsecond>()).symbol) == "u");
+
+  const double exponents[] = {-18, -15, -12, -9, -6, -3, -2, -1, 0, 1, 2, 3, 6, 9, 12, 15, 18};
+  for (size_t from = 0; from < kPrefixCount; ++from) {
+    REQUIRE(GetPrefix(from).exponent == exponents[from]);
+    for (size_t to = 0; to < kPrefixCount; ++to) {
+      const double expected = std::pow(10.0, exponents[from] - exponents[to]);
+      REQUIRE(std::abs(PrefixFactor(from, to) - expected) <= expected * 1e-15);
+    }
+  }
+  REQUIRE(ConvertPrefix(2.5, PrefixIndexOf<d::Kilometer>(), PrefixIndexOf<d::Millimeter>()) == 2500000.0);
+  REQUIRE(ConvertPrefix(2.5f, 11, 5) == 2500000.0f);
+
+  int64_t out = -1;
+  REQUIRE(ConvertPrefix(int64_t(7), 11, 5, &out));
+  REQUIRE(out == 7000000);
+  REQUIRE(ConvertPrefix(int64_t(-7999999), 5, 11, &out));
+  REQUIRE(out == -7);
+  REQUIRE(ConvertPrefix(int64_t(9), 16, 0, &out) == false);
+  REQUIRE(out == -7);
+  REQUIRE(ConvertPrefix(int64_t(0), 16, 0, &out));
+  REQUIRE(out == 0);
+  REQUIRE(ConvertPrefix(std::numeric_limits<int64_t>::max(), 0, 16, &out));
+  REQUIRE(out == 0);
+  REQUIRE(ConvertPrefix(int64_t(9223372), 6, 16, &out));
+  REQUIRE(ConvertPrefix(int64_t(9223373), 12, 0, &out) == false);
+  for (size_t from = 0; from < kPrefixCount; ++from) {
+    for (size_t to = 0; to < kPrefixCount; ++to) {
+      const int64_t values[] = {1, -1, 123456789, -987654321, 4611686018427387904LL};
+      for (int64_t v : values) {
+        const double expected = double(v) * std::pow(10.0, exponents[from] - exponents[to]);
+        if (ConvertPrefix(v, from, to, &out)) {
+          REQUIRE(std::abs(double(out) - std::trunc(expected)) <= std::abs(expected) * 1e-15 + 1e-9);
+        } else {
+          REQUIRE(std::abs(expected) > 9.2e18);
+        }
+      }
+    }
+  }
+
+  REQUIRE(SelectPrefix(0.00042, kUnprefixed) == 4);
+  REQUIRE(SelectPrefix(-420.0, 4) == 4);
+  REQUIRE(SelectPrefix(1000.0, 5) == kUnprefixed);
+  REQUIRE(SelectPrefix(999.0, 5) == 5);
+  REQUIRE(SelectPrefix(0.05, kUnprefixed, false) == 6);
+  REQUIRE(SelectPrefix(1e30, kUnprefixed) == kPrefixCount - 1);
+  REQUIRE(SelectPrefix(1e-30, kUnprefixed) == 0);
+  REQUIRE(SelectPrefix(0.0, 5) == 5);
+  const PrefixedValue shown = AutoPrefix(i::Microsecond(1500000));
+  REQUIRE(shown.value == 1.5);
+  REQUIRE(shown.prefix == kUnprefixed);
+  const PrefixedValue latency = AutoPrefix(d::Second(0.000042));
+  REQUIRE(latency.value == Approx(42.0));
+  REQUIRE(std::string(GetPrefix(latency.prefix).symbol) == "u");
+}
+
+TEST_CASE( "Allocation-free buffers") {
+#if !defined(UNITS_TEST_SANITIZED)
+  // The hook sees allocations made under a guard.
+  const size_t before = guarded_allocations;
+  {
+    AllocationGuard guard;
+    void* (*volatile allocate)(size_t) = &::operator new;
+    ::operator delete(allocate(64));
+  }
+  REQUIRE(guarded_allocations > before);
+#endif
+
+  const size_t baseline = guarded_allocations;
+  d::Millimeter mm[12];
+  for (size_t i = 0; i < 12; ++i) mm[i] = d::Millimeter(250.0 * i);
+  const i::Millimeter extra[2] = {i::Millimeter(9), i::Millimeter(10)};
+  i::Millimeter popped[8]{};
+  d::Meter last{};
+  size_t appended, pushed, removed;
+  bool rejected, overwritten, emptied;
+  FixedBuffer<d::Meter, 8> buffer;
+  FixedRing<i::Millimeter, 5> ring;
+  {
+    AllocationGuard guard;
+    appended = buffer.Append(mm, 12);
+    rejected = !buffer.PushBack(d::Kilometer(1.0));
+    buffer.PopBack(&last);
+    buffer.PushBack(d::Kilometer(1.0));
+
+    pushed = ring.Push(popped, 0);
+    for (int64_t i = 0; i < 4; ++i) ring.Push(i::Meter(i));
+    pushed += ring.Push(extra, 2);
+    overwritten = !ring.PushOverwrite(i::Centimeter(7));
+    removed = ring.Pop(popped, 8);
+    emptied = !ring.Pop(popped);
+  }
+  REQUIRE(guarded_allocations == baseline);
+  REQUIRE(appended == 8);
+  REQUIRE(rejected);
+  REQUIRE(last.GetValue() == 1.75);
+  REQUIRE(buffer.Size() == 8);
+  REQUIRE(buffer[7].GetValue() == 1000.0);
+  REQUIRE(buffer[2].GetValue() == 0.5);
+  REQUIRE(pushed == 1);
+  REQUIRE(overwritten);
+  REQUIRE(removed == 5);
+  REQUIRE(emptied);
+  REQUIRE(popped[0].GetValue() == 1000);
+  REQUIRE(popped[3].GetValue() == 9);
+  REQUIRE(popped[4].GetValue() == 70);
+
+  // A real-time producer hands samples to a consumer through an SPSC ring, neither side allocating.
+  const size_t samples = 100000;
+  SpscRing<i::Milliampere, 64> spsc;
+  std::atomic<bool> ordered(true);
+  std::thread producer([&] {
+    AllocationGuard guard;
+    i::Ampere batch[7];
+    for (size_t sent = 0; sent < samples;) {
+      const size_t n = std::min<size_t>(7, samples - sent);
+      for (size_t i = 0; i < n; ++i) batch[i] = i::Ampere(int64_t(sent + i));
+      size_t done = 0;
+      while (done < n) done += spsc.Push(batch + done, n - done);
+      sent += n;
+    }
+  });
+  {
+    AllocationGuard guard;
+    i::Milliampere received[16];
+    for (size_t next = 0; next < samples;) {
+      const size_t n = spsc.Pop(received, 16);
+      for (size_t i = 0; i < n; ++i, ++next) {
+        if (received[i].GetValue() != int64_t(next) * 1000) ordered = false;
+      }
+    }
+  }
+  producer.join();
+  REQUIRE(ordered);
+  REQUIRE(spsc.Size() == 0);
+  REQUIRE(guarded_allocations == baseline);
+}
+
+TEST_CASE( "Range checks and clamps") {
+  // Integer limits round inward when converted, so the raw check matches the exact cross-ratio comparison.
+  const Limits<i::Ampere> inward(i::Milliampere(-20500), i::Milliampere(20500));
+  REQUIRE(inward.GetLower() == -20);
+  REQUIRE(inward.GetUpper() == 20);
+  const Limits<i::Ampere> tiny(i::Milliampere(-20), i::Milliampere(-1500));
+  REQUIRE(tiny.GetLower() == 0);
+  REQUIRE(tiny.GetUpper() == -2);
+  const Limits<i::Nanoampere> saturated(i::Gigaampere(-20000000000LL), i::Gigaampere(20000000000LL));
+  REQUIRE(saturated.GetLower() == std::numeric_limits<int64_t>::lowest());
+  REQUIRE(saturated.GetUpper() == std::numeric_limits<int64_t>::max());
+  REQUIRE(Limits<d::Kelvin>::AtMost(d::Millikelvin(380000.0)).Contains(d::Kelvin(-1e300)));
+
+  const size_t n = 100003;
+  std::vector<i::Milliampere> ma(n);
+  GenerateUniform(Philox4x32(11), 0, ma.data(), n, i::Ampere(-25), i::Ampere(25));
+  const i::Ampere low(-20), high(20);
+  const Limits<i::Milliampere> limits(low, high);
+  std::vector<size_t> expected;
+  for (size_t i = 0; i < n; ++i) {
+    if (ma[i] < low || ma[i] > high) expected.push_back(i);
+  }
+  REQUIRE(!expected.empty());
+
+  for (unsigned threads : {1u, 3u, 8u}) {
+    std::vector<uint64_t> bitmap((n + 63) / 64, ~uint64_t(0));
+    REQUIRE(CheckRange(ma.data(), n, limits, bitmap.data(), threads) == expected.size());
+    size_t set = 0;
+    for (size_t i = 0; i < n; ++i) set += (bitmap[i / 64] >> (i % 64)) & 1;
+    REQUIRE(set == expected.size());
+    for (size_t i : expected) REQUIRE(((bitmap[i / 64] >> (i % 64)) & 1) == 1);
+    REQUIRE((bitmap.back() >> (n % 64)) == 0);
+
+    std::vector<size_t> indices(n);
+    const size_t found = FindViolations(ma.data(), n, limits, indices.data(), threads);
+    indices.resize(found);
+    REQUIRE(indices == expected);
+
+    std::vector<i::Milliampere> clamped(n);
+    REQUIRE(Clamp(ma.data(), clamped.data(), n, limits, threads) == expected.size());
+    for (size_t i = 0; i < n; ++i) {
+      REQUIRE(clamped[i].GetValue() == std::max<int64_t>(-20000, std::min<int64_t>(20000, ma[i].GetValue())));
+    }
+  }
+
+  // Doubles: NaN counts as a violation and is passed through by Clamp.
+  std::vector<d::Kelvin> temperature = {d::Kelvin(300.0), d::Kelvin(380.0), d::Kelvin(380.5),
+                                        d::Kelvin(std::numeric_limits<double>::quiet_NaN()), d::Kelvin(-5.0)};
+  const auto below = Limits<d::Kelvin>(d::Kelvin(0.0), d::Millikelvin(380000.0));
+  std::vector<size_t> hot(temperature.size());
+  hot.resize(FindViolations(temperature.data(), temperature.size(), below, hot.data(), 2));
+  REQUIRE((hot == std::vector<size_t>{2, 3, 4}));
+  REQUIRE(Clamp(temperature.data(), temperature.data(), temperature.size(), below) == 3);
+  REQUIRE(temperature[2].GetValue() == 380.0);
+  REQUIRE(std::isnan(temperature[3].GetValue()));
+  REQUIRE(temperature[4].GetValue() == 0.0);
+  REQUIRE(FindViolations(temperature.data(), 0, below, hot.data()) == 0);
+
+  const d::Microampere wide[] = {d::Microampere(1.5e6), d::Microampere(-3e25), d::Microampere(3e25),
+                                 d::Microampere(std::numeric_limits<double>::quiet_NaN()), d::Microampere(-2.7e6)};
+  i::Ampere narrow[5];
+  REQUIRE(SaturateConvert(wide, narrow, 5) == 3);
+  REQUIRE(narrow[0].GetValue() == 1);
+  REQUIRE(narrow[1].GetValue() == std::numeric_limits<int64_t>::lowest());
+  REQUIRE(narrow[2].GetValue() == std::numeric_limits<int64_t>::max());
+  REQUIRE(narrow[3].GetValue() == 0);
+  REQUIRE(narrow[4].GetValue() == -2);
+  const i::Milliampere big[] = {i::Milliampere(std::numeric_limits<int64_t>::max()), i::Milliampere(-7)};
+  Unit<int32_t, 0, 0, 0, 0, 0, 1, 0, 1, 1000000> micro[2];
+  REQUIRE(SaturateConvert(big, micro, 2) == 1);
+  REQUIRE(micro[0].GetValue() == std::numeric_limits<int32_t>::max());
+  REQUIRE(micro[1].GetValue() == -7000);
 }
@@ -5,7 +5,9 @@
  * @brief Compile time, constexpr class for expressing SI units.
  */
 
+#include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <ratio>
 #include <type_traits>
 
@@ -13,6 +15,98 @@
 
 namespace units {
 
+/**
+ * @~english
+ * @brief Trait for types accepted as the value type of a Unit. Specialize it for custom arithmetic types.
+ */
+template <typename T>
+struct is_value_type
+    : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<bool, T>::value> {};
+
+namespace detail {
+
+/**
+ * @~english
+ * Rescales a floating point value by the ratio R with a single multiply by the compile-time folded factor.
+ */
+template <typename R, typename T>
+constexpr T Rescale(T value, std::true_type) noexcept {
+  return value * (T(R::num) / T(R::den));
+}
+
+/**
+ * @~english
+ * Rescales an integral or custom value by the ratio R, multiplying before dividing to keep precision.
+ */
+template <typename R, typename T>
+constexpr T Rescale(T value, std::false_type) noexcept {
+  return R::num * value / R::den;
+}
+
+/**
+ * @~english
+ * Rescales a value by the ratio R.
+ * @param value The value to rescale.
+ * @return value * R.
+ */
+template <typename R, typename T>
+constexpr T Rescale(T value) noexcept {
+  return Rescale<R>(value, std::is_floating_point<T>());
+}
+
+/**
+ * @~english
+ * Computes floor(value * R) or ceil(value * R) for integers, saturating at the limits of T.
+ */
+template <typename R, typename T>
+T RescaleRounded(T value, bool up, std::false_type) noexcept {
+  const T num = T(R::num), den = T(R::den);
+  if (num > 1 && (value > std::numeric_limits<T>::max() / num || value < std::numeric_limits<T>::lowest() / num)) {
+    return value > 0 ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+  }
+  const T scaled = value * num;
+  T q = scaled / den;
+  const T r = scaled % den;
+  if (r != 0 && up && scaled > 0) ++q;
+  if (r != 0 && !up && scaled < 0) --q;
+  return q;
+}
+
+template <typename R, typename T>
+T RescaleRounded(T value, bool, std::true_type) noexcept {
+  return Rescale<R>(value);
+}
+
+/**
+ * @~english
+ * Rescales a value by the ratio R, rounding integers up or down instead of toward zero. Used where a bound converted
+ * into a coarser integer ratio must not move inward or outward, e.g. query ranges and limits.
+ * @param value The value to rescale.
+ * @param up Whether to round up (a lower bound) rather than down (an upper bound).
+ * @return value * R, rounded.
+ */
+template <typename R, typename T>
+T RescaleRounded(T value, bool up) noexcept {
+  return RescaleRounded<R>(value, up, std::is_floating_point<T>());
+}
+
+/**
+ * @~english
+ * The indices 0 to N - 1 as a pack, for building constexpr arrays element by element in C++11.
+ */
+template <size_t... I>
+struct IndexList {};
+
+template <size_t N, size_t... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct MakeIndexList<0, I...> {
+  using type = IndexList<I...>;
+};
+
+}  // namespace detail
+
 /**
  * @~english
  * @brief Constexpr ready class for expressing SI units. Supports basic arithmetic.
@@ -21,8 +115,8 @@ template <typename ValueType, int32_t Time, int32_t Distance, int32_t Luminance,
           int32_t Radians, int32_t Amperes, int32_t Mass, size_t Num = 1, size_t Denom = 1>
 class Unit {
  public:
-  static_assert(std::is_arithmetic<ValueType>::value && !std::is_same<bool, ValueType>::value,
-                "Only built-in integral and floating point types supported.");
+  static_assert(is_value_type<ValueType>::value,
+                "Only built-in integral and floating point types, or types registered with is_value_type, supported.");
 
   /**
    * @~english
@@ -30,6 +124,12 @@ class Unit {
    */
   using scale = std::ratio<Num, Denom>;
 
+  /**
+   * @~english
+   * The arithmetic type used to store the value of the unit.
+   */
+  using value_type = ValueType;
+
   /**
    * @~english
    * Unit type with identical units but different ratio.
@@ -37,6 +137,19 @@ class Unit {
   template <size_t Num2, size_t Den2>
   using units = Unit<ValueType, Time, Distance, Luminance, Temperature, Radians, Amperes, Mass, Num2, Den2>;
 
+  /**
+   * @~english
+   * Unit type with identical units and ratio but a different value type.
+   */
+  template <typename ValueType2>
+  using rebind = Unit<ValueType2, Time, Distance, Luminance, Temperature, Radians, Amperes, Mass, Num, Denom>;
+
+  /**
+   * @~english
+   * Default constructor. Leaves the value uninitialized so arrays of units stay trivially constructible.
+   */
+  Unit() = default;
+
   /**
    * @~english
    * Value constructor
@@ -50,10 +163,10 @@ class Unit {
    * @return Unit with the same value and given ratio.
    */
   template <size_t Num2, size_t Den2>
-  operator units<Num2, Den2>() const noexcept {
+  constexpr operator units<Num2, Den2>() const noexcept {
     using r = typename units<Num2, Den2>::scale;
-    using s = std::ratio_divide<r, scale>;
-    return units<Num2, Den2>(s::num * value_ / s::den);
+    using s = std::ratio_divide<scale, r>;
+    return units<Num2, Den2>(detail::Rescale<s>(value_));
   }
 
   /**
@@ -155,7 +268,7 @@ class Unit {
   template <int32_t S, int32_t M, int32_t C, int32_t K, int32_t Rad, int32_t A, int32_t KG, size_t Num2, size_t Denom2>
   constexpr
   Unit<ValueType, S + Time, M + Distance, C + Luminance, K + Temperature, Rad + Radians, A + Amperes, KG + Mass,
-       std::ratio<Num * Num2, Denom * Denom2>::num, std::ratio<Num * Num2, Denom * Denom2>::den>
+       std::ratio_multiply<scale, std::ratio<Num2, Denom2>>::num, std::ratio_multiply<scale, std::ratio<Num2, Denom2>>::den>
   operator*(const Unit<ValueType, S, M, C, K, Rad, A, KG, Num2, Denom2>& other) const {
     return {value_ * other.GetValue()};
   }
@@ -215,8 +328,8 @@ class Unit {
   template <int32_t S, int32_t M, int32_t C, int32_t K, int32_t Rad, int32_t A, int32_t KG, size_t Num2,
             size_t Denom2>
   constexpr
-  Unit<ValueType, Time - S, Distance - M, Luminance + C, Temperature + K, Radians + Rad, Amperes + A, Mass + KG,
-       std::ratio<Num * Denom2, Denom * Num2>::num, std::ratio<Num * Denom2, Denom * Num2>::den>
+  Unit<ValueType, Time - S, Distance - M, Luminance - C, Temperature - K, Radians - Rad, Amperes - A, Mass - KG,
+       std::ratio_divide<scale, std::ratio<Num2, Denom2>>::num, std::ratio_divide<scale, std::ratio<Num2, Denom2>>::den>
   operator/(const Unit<ValueType, S, M, C, K, Rad, A, KG, Num2, Denom2>& other) const {
     return {value_ / other.GetValue()};
   }
@@ -281,6 +394,24 @@ class Unit {
   ValueType value_;
 };
 
+/**
+ * @~english
+ * Converts an array of units to a different ratio of the same units. Uses the same folded factor as the conversion
+ * operator, so floating point arrays cost one multiply per element.
+ * @param in The units to convert.
+ * @param out The converted units. May alias in.
+ * @param n The number of units.
+ */
+template <typename To, typename From>
+void Convert(const From* in, To* out, size_t n) noexcept {
+  static_assert(std::is_same<typename From::template units<1, 1>, typename To::template units<1, 1>>::value,
+                "Conversion requires identical units and value type.");
+  using s = std::ratio_divide<typename From::scale, typename To::scale>;
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = To(detail::Rescale<s>(in[i].GetValue()));
+  }
+}
+
 /**
  * @~english
  * Defines all the base SI units with the given arithmetic type.